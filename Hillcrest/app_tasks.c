@@ -0,0 +1,229 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "app_tasks.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "timebase.h"
+#include "sensor_app.h"
+
+// Housekeeping wakes this often (ms) to check the deadlines.
+#define HOUSEKEEPING_PERIOD_MS (1000)
+
+// Define this as a period in ms to have housekeeping print pipeline
+// statistics periodically.  (Text output only.)
+// #define PRINT_STATS_PERIOD_MS (10000)
+
+// --- Type Definitions ---------------------------------------------------
+
+typedef struct response_s {
+	// Written by the trace hooks only, with interrupts masked
+	bool released;        // made ready, not yet blocked again
+	uint32_t release_us;
+	uint32_t jobs;
+	uint64_t total_us;
+	uint32_t worst_us;
+} response_t;
+
+// --- Private Data --------------------------------------------------------
+
+static const appTask_t *pTable = 0;
+static unsigned tableLen = 0;
+
+// By task number - 1
+static response_t responses[APP_TASKS_MAX];
+
+// --- Forward Declarations ------------------------------------------------
+
+static void taskEntry(void *params);
+static void getResponse(unsigned n, response_t *pResponse);
+static void isrList(uint32_t isrs, char *buf, size_t len);
+
+// --- Public API ----------------------------------------------------------
+
+void appTasks_create(const appTask_t *pTasks, unsigned count)
+{
+	configASSERT(count <= APP_TASKS_MAX);
+
+	// Deadline order, and the priorities with it: a shorter deadline
+	// gets a higher priority, an equal one the same.
+	for (unsigned n = 1; n < count; n++) {
+		const appTask_t *pPrev = &pTasks[n-1];
+		const appTask_t *pTask = &pTasks[n];
+
+		configASSERT(pTask->deadline_us >= pPrev->deadline_us);
+		configASSERT((pTask->deadline_us == pPrev->deadline_us) ?
+		             (pTask->priority == pPrev->priority) :
+		             (pTask->priority < pPrev->priority));
+	}
+
+	pTable = pTasks;
+	tableLen = count;
+
+	for (unsigned n = 0; n < count; n++) {
+		const appTask_t *pTask = &pTasks[n];
+		TaskHandle_t handle = 0;
+
+		xTaskCreate(taskEntry, pTask->name,
+		            pTask->stackWords,
+		            (void *)pTask,
+		            pTask->priority, &handle);
+		configASSERT(handle != 0);
+
+		// From here, the trace hooks know it
+		vTaskSetTaskNumber(handle, n + 1);
+		if (pTask->pHandle != 0) {
+			*pTask->pHandle = handle;
+		}
+	}
+}
+
+void appTasks_print(void)
+{
+	response_t response;
+	char wokenBy[80];
+
+	printf("  Task           Prio Stack Deadline     Jobs    Mean   Worst  Woken by\n");
+	for (unsigned n = 0; n < tableLen; n++) {
+		const appTask_t *pTask = &pTable[n];
+
+		getResponse(n, &response);
+		printf("  %-14s %4u %5u %8u %8u ", pTask->name,
+		       (unsigned)pTask->priority, pTask->stackWords,
+		       pTask->deadline_us, response.jobs);
+		if (response.jobs == 0) {
+			printf("%7s %7s ", "-", "-");
+		}
+		else {
+			printf("%7u %7u%c", (uint32_t)(response.total_us / response.jobs),
+			       response.worst_us,
+			       (response.worst_us > pTask->deadline_us) ? '!' : ' ');
+		}
+		isrList(pTask->isrs, wokenBy, sizeof(wokenBy));
+		printf("%s\n", wokenBy);
+	}
+	printf("Times in us, release to block.  ! marks a missed deadline.\n");
+}
+
+void housekeepingTask(void)
+{
+	// Worst response last reported, per task
+	uint32_t reported_us[APP_TASKS_MAX] = { 0 };
+	response_t response;
+#ifdef PRINT_STATS_PERIOD_MS
+	TickType_t lastStats = xTaskGetTickCount();
+#endif
+
+	while (1) {
+		vTaskDelay(timebase_ticksFor(HOUSEKEEPING_PERIOD_MS * 1000, configTICK_RATE_HZ));
+
+		// Other formats are parsed by the host, so stay quiet for them.
+		bool text = (sensorApp_getOutput() == SENSOR_APP_OUTPUT_TEXT);
+
+		// Report each new worst over a deadline
+		for (unsigned n = 0; n < tableLen; n++) {
+			const appTask_t *pTask = &pTable[n];
+
+			getResponse(n, &response);
+			if ((response.worst_us > pTask->deadline_us) &&
+			    (response.worst_us > reported_us[n])) {
+				reported_us[n] = response.worst_us;
+				if (text) {
+					printf("%s: response took %u us, deadline %u us.\n",
+					       pTask->name, response.worst_us, pTask->deadline_us);
+				}
+			}
+		}
+
+#ifdef PRINT_STATS_PERIOD_MS
+		if ((xTaskGetTickCount() - lastStats) >=
+		    timebase_ticksFor(PRINT_STATS_PERIOD_MS * 1000, configTICK_RATE_HZ)) {
+			lastStats = xTaskGetTickCount();
+			if (text) {
+				sensorApp_printStats();
+			}
+		}
+#endif
+	}
+}
+
+void appTasks_traceReady(UBaseType_t number)
+{
+	if ((number == 0) || (number > APP_TASKS_MAX)) {
+		return;
+	}
+
+	response_t *pResponse = &responses[number - 1];
+	if (!pResponse->released) {
+		pResponse->released = true;
+		pResponse->release_us = timebase_now32();
+	}
+}
+
+void appTasks_traceSwitchedOut(UBaseType_t number, BaseType_t blocked)
+{
+	if ((number == 0) || (number > APP_TASKS_MAX) || !blocked) {
+		return;
+	}
+
+	response_t *pResponse = &responses[number - 1];
+	if (pResponse->released) {
+		uint32_t response_us = timebase_now32() - pResponse->release_us;
+
+		pResponse->released = false;
+		pResponse->jobs++;
+		pResponse->total_us += response_us;
+		if (response_us > pResponse->worst_us) {
+			pResponse->worst_us = response_us;
+		}
+	}
+}
+
+// --- Private functions ---------------------------------------------------
+
+static void taskEntry(void *params)
+{
+	const appTask_t *pTask = (const appTask_t *)params;
+
+	// (Never returns.)
+	pTask->entry();
+}
+
+// A consistent copy of a task's responses.
+static void getResponse(unsigned n, response_t *pResponse)
+{
+	taskENTER_CRITICAL();
+	*pResponse = responses[n];
+	taskEXIT_CRITICAL();
+}
+
+// Names of the interrupts in isrs, each after a space.
+static void isrList(uint32_t isrs, char *buf, size_t len)
+{
+	size_t used = 0;
+
+	buf[0] = 0;
+	for (unsigned isr = 0; (isr < CPU_NUM_ISRS) && (used < len); isr++) {
+		if (isrs & (1u << isr)) {
+			used += snprintf(buf + used, len - used, " %s",
+			                 cpuStats_isrName((cpuStats_isr_t)isr));
+		}
+	}
+}
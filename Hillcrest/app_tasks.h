@@ -0,0 +1,72 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef APP_TASKS_H
+#define APP_TASKS_H
+
+// The application's tasks, from one table.
+//
+// Each entry gives a task's stack, priority, response deadline and the
+// interrupts whose handlers wake it.  The table is in deadline order and
+// the priorities must follow it (deadline monotonic): appTasks_create
+// asserts that they do.
+//
+// A task's response time runs from when it is made ready (an interrupt or
+// another task releases it) until it blocks again, preemption included.
+// The kernel's trace hooks in FreeRTOSConfig.h measure it on TIM2.  A job
+// that blocks part way, on a mutex say, counts as two.
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "cpu_stats.h"
+
+// Most tasks in a table
+#define APP_TASKS_MAX (6)
+
+// Bit for one interrupt in an entry's isrs
+#define APP_TASK_ISR(isr) (1u << CPU_ISR_##isr)
+
+typedef struct appTask_s {
+	const char *name;
+	void (*entry)(void);        // never returns
+	uint16_t stackWords;
+	UBaseType_t priority;
+	uint32_t deadline_us;       // release to block
+	uint32_t isrs;              // APP_TASK_ISR bits of the handlers that wake it
+	TaskHandle_t *pHandle;      // or 0
+} appTask_t;
+
+// Create the table's tasks.  pTasks must stay valid: the report reads it.
+void appTasks_create(const appTask_t *pTasks, unsigned count);
+
+// Print each task's plan and its measured responses: count, mean and
+// worst since boot.
+void appTasks_print(void);
+
+// Housekeeping task body: watch the deadlines and print periodic
+// statistics.  (Never returns.)
+void housekeepingTask(void);
+
+// From the kernel's trace hooks only.  number is the task's number, 0
+// for tasks not in the table; blocked is false if it was preempted.
+void appTasks_traceReady(UBaseType_t number);
+void appTasks_traceSwitchedOut(UBaseType_t number, BaseType_t blocked);
+
+#endif
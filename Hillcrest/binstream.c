@@ -0,0 +1,176 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+// Binary framing for sensor events: COBS, CRC-16.
+// Shared by the firmware and the host side decoder in Tools/.
+
+#include "binstream.h"
+
+#include <string.h>
+
+// ------------------------------------------------------------------------
+// Public API
+
+uint16_t binstream_crc16(uint16_t crc, const uint8_t *pData, size_t len)
+{
+	for (size_t n = 0; n < len; n++) {
+		crc ^= (uint16_t)pData[n] << 8;
+		for (int bit = 0; bit < 8; bit++) {
+			if (crc & 0x8000) {
+				crc = (crc << 1) ^ 0x1021;
+			}
+			else {
+				crc = crc << 1;
+			}
+		}
+	}
+
+	return crc;
+}
+
+size_t binstream_frame(uint8_t *pOut, uint8_t type,
+                       const uint8_t *pBody, size_t len)
+{
+	uint16_t crc;
+	uint8_t crcBytes[BINSTREAM_CRC_LEN];
+	size_t total = 1 + len + BINSTREAM_CRC_LEN;
+	size_t codeIdx = 0;     // where the current COBS code byte goes
+	size_t outIdx = 1;
+	uint8_t code = 1;
+
+	crc = binstream_crc16(0xFFFF, &type, 1);
+	crc = binstream_crc16(crc, pBody, len);
+	crcBytes[0] = crc & 0xFF;
+	crcBytes[1] = crc >> 8;
+
+	// COBS encode type, body, crc as one run
+	for (size_t n = 0; n < total; n++) {
+		uint8_t b;
+		if (n == 0) {
+			b = type;
+		}
+		else if (n <= len) {
+			b = pBody[n-1];
+		}
+		else {
+			b = crcBytes[n-1-len];
+		}
+
+		if (b == 0) {
+			pOut[codeIdx] = code;
+			codeIdx = outIdx++;
+			code = 1;
+		}
+		else {
+			pOut[outIdx++] = b;
+			code++;
+			if (code == 0xFF) {
+				pOut[codeIdx] = code;
+				codeIdx = outIdx++;
+				code = 1;
+			}
+		}
+	}
+	pOut[codeIdx] = code;
+
+	// Frame delimiter
+	pOut[outIdx++] = 0;
+
+	return outIdx;
+}
+
+size_t binstream_encodeEvent(uint8_t *pOut, const binstream_event_t *pEvent)
+{
+	uint8_t body[BINSTREAM_EVENT_LEN - 1];
+
+	body[0] = (pEvent->unit << BINSTREAM_UNIT_SHIFT) |
+		(pEvent->sensor & BINSTREAM_SENSOR_MASK);
+	body[1] = pEvent->sequence;
+	body[2] = pEvent->format;
+	body[3] = (pEvent->qPoint << 4) | (pEvent->qPointLast & 0x0F);
+	body[4] = pEvent->status;
+	body[5] = pEvent->time_us & 0xFF;
+	body[6] = (pEvent->time_us >> 8) & 0xFF;
+	body[7] = (pEvent->time_us >> 16) & 0xFF;
+	body[8] = (pEvent->time_us >> 24) & 0xFF;
+	for (int n = 0; n < BINSTREAM_NUM_VALUES; n++) {
+		body[9 + 2*n] = (uint16_t)pEvent->v[n] & 0xFF;
+		body[10 + 2*n] = (uint16_t)pEvent->v[n] >> 8;
+	}
+
+	return binstream_frame(pOut, BINSTREAM_TYPE_EVENT, body, sizeof(body));
+}
+
+size_t binstream_unframe(uint8_t *pFrame, size_t len)
+{
+	size_t in = 0;
+	size_t out = 0;
+
+	// COBS decode in place.  Output never overtakes input.
+	while (in < len) {
+		uint8_t code = pFrame[in++];
+		if (code == 0) {
+			return 0;
+		}
+		for (uint8_t n = 1; n < code; n++) {
+			if (in >= len) {
+				return 0;
+			}
+			pFrame[out++] = pFrame[in++];
+		}
+		if ((code != 0xFF) && (in < len)) {
+			pFrame[out++] = 0;
+		}
+	}
+
+	if (out < 1 + BINSTREAM_CRC_LEN) {
+		return 0;
+	}
+	out -= BINSTREAM_CRC_LEN;
+
+	uint16_t crc = binstream_crc16(0xFFFF, pFrame, out);
+	if ((pFrame[out] != (crc & 0xFF)) || (pFrame[out+1] != (crc >> 8))) {
+		return 0;
+	}
+
+	return out;
+}
+
+int binstream_decodeEvent(binstream_event_t *pEvent,
+                          const uint8_t *pFrame, size_t len)
+{
+	if ((len != BINSTREAM_EVENT_LEN) || (pFrame[0] != BINSTREAM_TYPE_EVENT)) {
+		return -1;
+	}
+	const uint8_t *body = &pFrame[1];
+
+	pEvent->unit = body[0] >> BINSTREAM_UNIT_SHIFT;
+	pEvent->sensor = body[0] & BINSTREAM_SENSOR_MASK;
+	pEvent->sequence = body[1];
+	pEvent->format = body[2];
+	pEvent->qPoint = body[3] >> 4;
+	pEvent->qPointLast = body[3] & 0x0F;
+	pEvent->status = body[4];
+	pEvent->time_us = (uint32_t)body[5] | ((uint32_t)body[6] << 8) |
+		((uint32_t)body[7] << 16) | ((uint32_t)body[8] << 24);
+	for (int n = 0; n < BINSTREAM_NUM_VALUES; n++) {
+		pEvent->v[n] = (int16_t)(body[9 + 2*n] | (body[10 + 2*n] << 8));
+	}
+
+	return 0;
+}
@@ -0,0 +1,101 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef BINSTREAM_H
+#define BINSTREAM_H
+
+// Compact binary framing for sensor events.
+//
+// Each frame is COBS encoded and terminated by a 0x00 delimiter.  Decoded,
+// a frame is a type byte, a body and a CRC-16 (CCITT, init 0xFFFF) over
+// type and body, sent little-endian.
+//
+//   BINSTREAM_TYPE_HEADER : body is DSF header text, no trailing newline.
+//   BINSTREAM_TYPE_EVENT  : body is a fixed size event record:
+//     0     sensor id, unit (hub) in the top two bits
+//     1     sequence number
+//     2     format (BINSTREAM_FMT_*)
+//     3     q points, high nibble for v[0..3], low nibble for v[4]
+//     4     status
+//     5..8  timestamp, us
+//     9..18 v[0..4], int16
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BINSTREAM_TYPE_HEADER ('H')
+#define BINSTREAM_TYPE_EVENT  ('E')
+
+// Event payload layouts
+#define BINSTREAM_FMT_RAW3        (0)  // v[0..2] raw ADC units
+#define BINSTREAM_FMT_Q3          (1)  // v[0..2] fixed point
+#define BINSTREAM_FMT_Q3_STATUS   (2)  // v[0..2] fixed point, plus status
+#define BINSTREAM_FMT_QUAT        (3)  // v[0..3] quaternion r,i,j,k, v[4] accuracy
+
+// Byte 0 of an event
+#define BINSTREAM_SENSOR_MASK (0x3F)
+#define BINSTREAM_UNIT_SHIFT  (6)
+
+// Events from unit u are DSF channel u * BINSTREAM_UNIT_CHANNELS + sensor,
+// so unit 0 keeps the sensor ids as channels.
+#define BINSTREAM_UNIT_CHANNELS (100)
+
+#define BINSTREAM_NUM_VALUES (5)
+#define BINSTREAM_EVENT_LEN  (1 + 9 + 2*BINSTREAM_NUM_VALUES)
+#define BINSTREAM_CRC_LEN    (2)
+
+// Largest encoded frame for a decoded frame of len bytes: CRC, COBS overhead
+// and delimiter.
+#define BINSTREAM_FRAME_MAX(len) \
+	((len) + BINSTREAM_CRC_LEN + ((len) + BINSTREAM_CRC_LEN)/254 + 2)
+
+typedef struct binstream_event_s {
+	uint8_t unit;
+	uint8_t sensor;
+	uint8_t sequence;
+	uint8_t format;
+	uint8_t qPoint;       // q point of v[0..3]
+	uint8_t qPointLast;   // q point of v[4]
+	uint8_t status;
+	uint32_t time_us;
+	int16_t v[BINSTREAM_NUM_VALUES];
+} binstream_event_t;
+
+// CRC-16/CCITT over len bytes, starting from crc (0xFFFF for a new frame).
+uint16_t binstream_crc16(uint16_t crc, const uint8_t *pData, size_t len);
+
+// Build a complete encoded frame (CRC, COBS, delimiter) of the given type
+// and body into pOut, which must hold BINSTREAM_FRAME_MAX(1+len) bytes.
+// Returns the encoded length.
+size_t binstream_frame(uint8_t *pOut, uint8_t type,
+                       const uint8_t *pBody, size_t len);
+
+// Frame an event record.  pOut must hold
+// BINSTREAM_FRAME_MAX(BINSTREAM_EVENT_LEN) bytes.
+size_t binstream_encodeEvent(uint8_t *pOut, const binstream_event_t *pEvent);
+
+// Decode one COBS frame (without its delimiter) in place, check its CRC.
+// Returns the length of type plus body, or 0 if the frame is corrupt.
+size_t binstream_unframe(uint8_t *pFrame, size_t len);
+
+// Parse a decoded event frame, as returned by binstream_unframe.
+// Returns 0 on success, -1 if the frame is not a valid event.
+int binstream_decodeEvent(binstream_event_t *pEvent,
+                          const uint8_t *pFrame, size_t len);
+
+#endif
@@ -22,12 +22,34 @@
 #include "console.h"
 
 #include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
 #include <stm32f4xx_hal.h>
 #include <FreeRTOS.h>
+#include <task.h>
 #include <semphr.h>
 
+#include "rtos_pool.h"
+#include "timebase.h"
+
 #define CONSOLE_BUFLEN (128)
 
+// Space in the tx ring that bulk records may not use, so status and error
+// messages still get through while sensor output saturates the link.
+#ifndef CONSOLE_TXRESERVE
+#define CONSOLE_TXRESERVE (CONSOLE_TXBUFLEN/4)
+#endif
+
+// How long to wait for the host to confirm a new baud rate (ms)
+#ifndef CONSOLE_BAUD_CONFIRM_MS
+#define CONSOLE_BAUD_CONFIRM_MS (5000)
+#endif
+
+// Define as true to start in lossy (non-blocking) mode.
+#ifndef CONSOLE_LOSSY_DEFAULT
+#define CONSOLE_LOSSY_DEFAULT (false)
+#endif
+
 // ------------------------------------------------------------------------
 // Private state variables
 
@@ -40,12 +62,23 @@ volatile bool txBlocked;
 SemaphoreHandle_t txBlockSem;
 SemaphoreHandle_t txMutex;
 
-// Which buffer owned by process, other owned by interrupt.
-unsigned txPhase = 0;
+// Transmit ring buffer.  Process inserts at txHead, DMA reads from txTail.
+// The ring is empty when txHead == txTail, so one byte is always left unused.
+uint8_t txBuffer[CONSOLE_TXBUFLEN];
+volatile unsigned txHead;
+volatile unsigned txTail;
+
+// Length of the contiguous region currently owned by DMA.
+volatile unsigned txChunk;
+
+// Transmit statistics
+volatile uint32_t txBytes;
+volatile uint32_t txDmaTransfers;
 
-// Double buffers for transmit
-uint8_t txBuffer[2][CONSOLE_BUFLEN];
-volatile unsigned txBufLen[2];
+// Lossy mode: records that don't fit are dropped instead of blocking.
+volatile bool txLossy;
+uint32_t txDropRecords[CONSOLE_NUM_SOURCES];
+uint32_t txDropBytes[CONSOLE_NUM_SOURCES];
 
 SemaphoreHandle_t rxBlockSem;
 SemaphoreHandle_t rxMutex;
@@ -57,11 +90,22 @@ unsigned rxNextIn;
 unsigned rxNextOut;
 unsigned rxDrops;
 
+// Transmit and receive semaphores and mutexes
+RTOS_POOL(consolePool, "console", 2 * RTOS_SEMAPHORE_BYTES + 2 * RTOS_MUTEX_BYTES);
+
 // ------------------------------------------------------------------------
 // Forward declarations
 
-void startTx(void);
-void startTxIsr(void);
+static void startTx(void);
+static unsigned txFree(void);
+static unsigned txWaitSpace(unsigned need);
+static void txInsert(const uint8_t *pSrc, unsigned len);
+static void txCopy(const uint8_t *pSrc, size_t len, bool crlf);
+static size_t writeRecord(const uint8_t *pSrc, size_t len, bool crlf,
+                          console_source_t source, console_prio_t prio);
+static void txDrain(void);
+static void applyBaud(uint32_t baud);
+static bool rxWait(TickType_t ticks);
 
 // ------------------------------------------------------------------------
 // Public API
@@ -69,14 +113,22 @@ void startTxIsr(void);
 void console_init(UART_HandleTypeDef *huart)
 {
 	console_huart = huart;
+	rtosPool_begin(&consolePool);
 
 	txActive = false;
 	txBlocked = false;
 	txBlockSem = xSemaphoreCreateBinary();
 	txMutex = xSemaphoreCreateMutex();
-	txPhase = 0;
-	txBufLen[0] = 0;
-	txBufLen[1] = 0;
+	txHead = 0;
+	txTail = 0;
+	txChunk = 0;
+	txBytes = 0;
+	txDmaTransfers = 0;
+	txLossy = CONSOLE_LOSSY_DEFAULT;
+	for (int n = 0; n < CONSOLE_NUM_SOURCES; n++) {
+		txDropRecords[n] = 0;
+		txDropBytes[n] = 0;
+	}
 
     // Receive support
 	rxBlocked = false;
@@ -86,6 +138,99 @@ void console_init(UART_HandleTypeDef *huart)
 	rxNextOut = 0;  // rxBuffer empty when rxNextIn == rxNextOut
 	rxDrops = 0;
 	rxActive = false;
+
+	rtosPool_end();
+}
+
+void console_getStats(console_stats_t *pStats)
+{
+	HAL_NVIC_DisableIRQ(USART2_IRQn);
+	pStats->txBytes = txBytes;
+	pStats->txDmaTransfers = txDmaTransfers;
+	pStats->rxDrops = rxDrops;
+	HAL_NVIC_EnableIRQ(USART2_IRQn);
+
+	// Drop counters only change under txMutex
+	xSemaphoreTake(txMutex, portMAX_DELAY);
+	for (int n = 0; n < CONSOLE_NUM_SOURCES; n++) {
+		pStats->dropRecords[n] = txDropRecords[n];
+		pStats->dropBytes[n] = txDropBytes[n];
+	}
+	xSemaphoreGive(txMutex);
+}
+
+void console_setLossy(bool lossy)
+{
+	txLossy = lossy;
+}
+
+uint32_t console_actualBaud(uint32_t baud)
+{
+	uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+
+	// Reject rates the UART can't reach (USARTDIV < 1)
+	if ((baud == 0) || (baud > pclk/16)) {
+		return 0;
+	}
+
+	// With 16x oversampling, baud = pclk / BRR
+	uint32_t brr = UART_BRR_SAMPLING16(pclk, baud);
+
+	return (pclk + brr/2) / brr;
+}
+
+void console_printBaudRates(void)
+{
+	static const uint32_t rates[] = {
+		115200, 230400, 460800, 921600, 1000000, 1500000, 2000000,
+	};
+
+	printf("Console baud rates, PCLK1 %u Hz:\n", HAL_RCC_GetPCLK1Freq());
+	for (unsigned n = 0; n < sizeof(rates)/sizeof(rates[0]); n++) {
+		uint32_t actual = console_actualBaud(rates[n]);
+		if (actual == 0) {
+			printf("  %7u : not supported\n", rates[n]);
+			continue;
+		}
+		
+		// error in hundredths of a percent
+		int32_t err = (int32_t)(((int64_t)actual - rates[n]) * 10000 / rates[n]);
+		printf("  %7u : actual %7u, error %s%d.%02d%%\n",
+		       rates[n], actual, (err < 0) ? "-" : "",
+		       (err < 0 ? -err : err) / 100, (err < 0 ? -err : err) % 100);
+	}
+}
+
+int console_setBaud(uint32_t baud)
+{
+	uint32_t oldBaud = console_huart->Init.BaudRate;
+	uint32_t actual = console_actualBaud(baud);
+
+	if (actual == 0) {
+		printf("Baud rate %u not supported.\n", baud);
+		return -1;
+	}
+
+	// Announce, then let the announcement go out at the old rate.
+	printf("Switching console to %u baud (actual %u).\n"
+	       "Reconnect and press a key within %u ms to confirm.\n",
+	       baud, actual, CONSOLE_BAUD_CONFIRM_MS);
+	xSemaphoreTake(txMutex, portMAX_DELAY);
+	txDrain();
+	applyBaud(baud);
+	xSemaphoreGive(txMutex);
+
+	if (!rxWait(timebase_ticksFor(CONSOLE_BAUD_CONFIRM_MS * 1000, configTICK_RATE_HZ))) {
+		// No word from the host, go back.
+		xSemaphoreTake(txMutex, portMAX_DELAY);
+		applyBaud(oldBaud);
+		xSemaphoreGive(txMutex);
+		printf("No confirmation, console stays at %u baud.\n", oldBaud);
+		return -1;
+	}
+
+	printf("Console now at %u baud.\n", baud);
+	return 0;
 }
 
 size_t __read(int Handle, unsigned char * Buf, size_t BufSize)
@@ -164,41 +309,134 @@ int getchar(void)
 
 size_t __write(int Handle, const unsigned char * Buf, size_t Bufsize)
 {
-	size_t n;
-	int rc;
-
 	// This function only works for stdout, stderr
 	if (!((Handle == 1) || (Handle == 2))) {
 		return -1;
 	}
 
-	for (n = 0; n < Bufsize; n++) {
-		rc = putchar(Buf[n]);
-		if (rc < 0) break;
+	return console_write(Buf, Bufsize);
+}
+
+int putchar(int c)
+{
+	uint8_t ch = c;
+
+	console_write(&ch, 1);
+
+	return c;
+}
+
+size_t console_write(const void *pData, size_t len)
+{
+	if (txLossy) {
+		// Treat each block as a record so lines are never cut short.
+		return console_writeRecord(pData, len,
+		                           CONSOLE_SRC_STDIO, CONSOLE_PRIO_HIGH);
 	}
 
-	return n;
+	// Acquire mutex to prevent tasks from stomping each other.
+	xSemaphoreTake(txMutex, portMAX_DELAY);
+
+	txCopy(pData, len, true);
+
+	// Allow other tasks to transmit again.
+	xSemaphoreGive(txMutex);
+
+	return len;
 }
 
-int putchar(int c)
+size_t console_writeRecord(const void *pData, size_t len,
+                           console_source_t source, console_prio_t prio)
 {
-	// expand LF to CR-LF
-	if (c == '\n') {
-		int rc = putchar('\r');
-		if (rc < 0) {
-			return rc;
+	return writeRecord((const uint8_t *)pData, len, true, source, prio);
+}
+
+size_t console_writeFrame(const void *pData, size_t len,
+                          console_source_t source, console_prio_t prio)
+{
+	return writeRecord((const uint8_t *)pData, len, false, source, prio);
+}
+
+void console_flush(void)
+{
+	xSemaphoreTake(txMutex, portMAX_DELAY);
+	txDrain();
+	xSemaphoreGive(txMutex);
+}
+
+// ------------------------------------------------------------------------
+// Private utility functions
+
+// Write a record, dropping it in lossy mode if it doesn't fit.  LF is
+// expanded to CR-LF if crlf is set.
+static size_t writeRecord(const uint8_t *pSrc, size_t len, bool crlf,
+                          console_source_t source, console_prio_t prio)
+{
+	unsigned need = len;
+	unsigned reserve = (prio == CONSOLE_PRIO_BULK) ? CONSOLE_TXRESERVE : 0;
+
+	// Account for LF to CR-LF expansion
+	if (crlf) {
+		for (const uint8_t *pLf = memchr(pSrc, '\n', len); pLf != 0;
+		     pLf = memchr(pLf + 1, '\n', len - (pLf + 1 - pSrc))) {
+			need++;
 		}
 	}
 	
 	// Acquire mutex to prevent tasks from stomping each other.
 	xSemaphoreTake(txMutex, portMAX_DELAY);
-	
-	// Disable USART2 interrupt while manipulating tx buffers
+
+	if (txLossy) {
+		HAL_NVIC_DisableIRQ(USART2_IRQn);
+		unsigned space = txFree();
+		HAL_NVIC_EnableIRQ(USART2_IRQn);
+
+		if (need + reserve > space) {
+			// Doesn't fit, drop the whole record.
+			txDropRecords[source]++;
+			txDropBytes[source] += len;
+			xSemaphoreGive(txMutex);
+			return 0;
+		}
+	}
+	else if (need + reserve < CONSOLE_TXBUFLEN) {
+		// Wait until the whole record fits so it goes out contiguously.
+		txWaitSpace(need + reserve);
+	}
+
+	txCopy(pSrc, len, crlf);
+
+	// Allow other tasks to transmit again.
+	xSemaphoreGive(txMutex);
+
+	return len;
+}
+
+// Space available in tx ring.  Call with USART2 interrupt disabled.
+static unsigned txFree(void)
+{
+	unsigned used = (txHead + CONSOLE_TXBUFLEN - txTail) % CONSOLE_TXBUFLEN;
+
+	return CONSOLE_TXBUFLEN - 1 - used;
+}
+
+// Block until at least 'need' bytes are free in the tx ring.
+// Returns the space available.  Call holding txMutex.
+static unsigned txWaitSpace(unsigned need)
+{
+	unsigned space;
+
+	// Disable USART2 interrupt while examining tx buffer
 	HAL_NVIC_DisableIRQ(USART2_IRQn);
 	
-	// If current buffer is full, block until it's empty
-	if (txBufLen[txPhase] == CONSOLE_BUFLEN) {
+	// If ring is full, block until DMA frees some space
+	while ((space = txFree()) < need) {
 		txBlocked = true;
+
+		// Make sure something will drain the ring.
+		if (!txActive) {
+			startTx();
+		}
 		
 		// Re-enable USART2 interrupt while blocking
 		HAL_NVIC_EnableIRQ(USART2_IRQn);
@@ -206,72 +444,186 @@ int putchar(int c)
 		// Block on semaphore until ISR frees up space.
 		xSemaphoreTake(txBlockSem, portMAX_DELAY);
 		
-		// Disable USART2 interrupt again while blocking
+		// Disable USART2 interrupt again while examining tx buffer
 		HAL_NVIC_DisableIRQ(USART2_IRQn);
 	}
-	
-	// Put this character into current buffer
-	txBuffer[txPhase][txBufLen[txPhase]] = c;
-	txBufLen[txPhase]++;
 
-	// If tx is inactive, start it.
-	if (!txActive) {
-		// Start a new transmission
-		startTx();
-	} 
-	
-	// Re-enable USART2 interrupts now
 	HAL_NVIC_EnableIRQ(USART2_IRQn);
-	
-	// Allow other tasks to transmit again.
-	xSemaphoreGive(txMutex);
 
-	return c;
+	return space;
 }
 
-// ------------------------------------------------------------------------
-// Private utility functions
+// Copy a block into the tx ring, expanding LF to CR-LF if crlf is set,
+// waiting for space as needed.  Call holding txMutex.
+static void txCopy(const uint8_t *pSrc, size_t len, bool crlf)
+{
+	size_t n = 0;
+
+	while (n < len) {
+		if (crlf && (pSrc[n] == '\n')) {
+			// expand LF to CR-LF
+			static const uint8_t crlf[2] = { '\r', '\n' };
+			txWaitSpace(sizeof(crlf));
+			txInsert(crlf, sizeof(crlf));
+			n++;
+			continue;
+		}
 
-static void startTx(void)
+		// Copy everything up to the next LF as a single run
+		size_t run = len - n;
+		const uint8_t *pLf = crlf ? memchr(&pSrc[n], '\n', run) : 0;
+		if (pLf != 0) {
+			run = pLf - &pSrc[n];
+		}
+		unsigned space = txWaitSpace(1);
+		if (run > space) {
+			run = space;
+		}
+		txInsert(&pSrc[n], run);
+		n += run;
+	}
+}
+
+// Wait until everything queued has left the UART.  Call holding txMutex.
+static void txDrain(void)
+{
+	while (txActive || (txHead != txTail)) {
+		vTaskDelay(1);
+	}
+	while (__HAL_UART_GET_FLAG(console_huart, UART_FLAG_TC) == RESET) {
+		vTaskDelay(1);
+	}
+}
+
+// Reprogram the baud rate generator.  Transmit must be idle.
+// Receive interrupt state is left as is.
+static void applyBaud(uint32_t baud)
+{
+	uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+
+	HAL_NVIC_DisableIRQ(USART2_IRQn);
+	__HAL_UART_DISABLE(console_huart);
+	console_huart->Init.BaudRate = baud;
+	console_huart->Instance->BRR = UART_BRR_SAMPLING16(pclk, baud);
+	__HAL_UART_ENABLE(console_huart);
+	HAL_NVIC_EnableIRQ(USART2_IRQn);
+}
+
+// Wait for any character to arrive and discard it.
+// Returns true if one arrived before the timeout.
+static bool rxWait(TickType_t ticks)
 {
-	unsigned isrBuf = txPhase;
+	bool received;
 
-	// Swap buffers and clear new tx buffer
-	txPhase = txPhase ? 0 : 1;
-	txBufLen[txPhase] = 0;
+	xSemaphoreTake(rxMutex, portMAX_DELAY);
+
+	if (!rxActive) {
+		// Start receiving.
+		rxActive = true;
+		HAL_UART_Receive_IT(console_huart, &rxChar, 1);
+	}
 	
-	// Start transmission of current buffer
-	txActive = true;
-	HAL_UART_Transmit_IT(console_huart, txBuffer[isrBuf], txBufLen[isrBuf]);
+	// Discard anything received before now, then wait for more.
+	HAL_NVIC_DisableIRQ(USART2_IRQn);
+	rxNextOut = rxNextIn;
+	rxBlocked = true;
+	HAL_NVIC_EnableIRQ(USART2_IRQn);
+
+	received = (xSemaphoreTake(rxBlockSem, ticks) == pdTRUE);
+
+	HAL_NVIC_DisableIRQ(USART2_IRQn);
+	rxBlocked = false;
+	rxNextOut = rxNextIn;
+	HAL_NVIC_EnableIRQ(USART2_IRQn);
+
+	// Clear a give that raced with the timeout.
+	xSemaphoreTake(rxBlockSem, 0);
+
+	xSemaphoreGive(rxMutex);
+
+	return received;
 }
 
-static void startTxIsr(void)
+// Copy len bytes into the tx ring and start tx if idle.
+// Caller holds txMutex and has checked there is room.
+static void txInsert(const uint8_t *pSrc, unsigned len)
 {
-	BaseType_t woken = pdFALSE;
+	unsigned head = txHead;
 
-	startTx();
+	// The region past txHead belongs to this writer, so the copy needs no
+	// interrupt lockout.  It may wrap around the end of the ring.
+	unsigned first = CONSOLE_TXBUFLEN - head;
+	if (first > len) {
+		first = len;
+	}
+	memcpy(&txBuffer[head], pSrc, first);
+	memcpy(&txBuffer[0], pSrc + first, len - first);
+	head += len;
+	if (head >= CONSOLE_TXBUFLEN) {
+		head -= CONSOLE_TXBUFLEN;
+	}
 
-	if (txBlocked) {
-		txBlocked = false;
-		xSemaphoreGiveFromISR(txBlockSem, &woken);
+	// Publish new data, start tx if it's inactive.
+	HAL_NVIC_DisableIRQ(USART2_IRQn);
+	txHead = head;
+	if (!txActive) {
+		startTx();
 	}
+	HAL_NVIC_EnableIRQ(USART2_IRQn);
+}
+
+// Hand the next contiguous region of the ring to DMA.
+// Call with USART2 interrupt disabled (or from the USART2 ISR.)
+static void startTx(void)
+{
+	unsigned head = txHead;
+	unsigned tail = txTail;
+
+	if (head == tail) {
+		// Nothing to send
+		txActive = false;
+		return;
+	}
+
+	// Send up to the head, or up to the end of the ring if the data wraps.
+	// The remainder goes out in the next transfer.
+	txChunk = (head > tail) ? (head - tail) : (CONSOLE_TXBUFLEN - tail);
 	
-	portYIELD_FROM_ISR(woken);
+	txActive = true;
+	if (HAL_UART_Transmit_DMA(console_huart, &txBuffer[tail], txChunk) != HAL_OK) {
+		// UART busy or locked.  Next putchar will try again.
+		txChunk = 0;
+		txActive = false;
+		return;
+	}
+	txDmaTransfers++;
 }
 
 void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
 {
+	BaseType_t woken = pdFALSE;
+
 	if (huart->Instance == USART2) {
-		// One transmission is complete.
-		if (txBufLen[txPhase] != 0) {
-			// Start the next transmission
-			startTxIsr();
+		// One transfer is complete, release its region of the ring.
+		unsigned tail = txTail + txChunk;
+		if (tail >= CONSOLE_TXBUFLEN) {
+			tail -= CONSOLE_TXBUFLEN;
 		}
-		else {
-			// Go to inactive state
-			txActive = false;
+		txTail = tail;
+		txBytes += txChunk;
+		txChunk = 0;
+
+		// Start the next transfer, if any data is waiting.
+		startTx();
+
+		// Space was freed, wake a blocked writer.
+		if (txBlocked) {
+			txBlocked = false;
+			xSemaphoreGiveFromISR(txBlockSem, &woken);
 		}
 	}
+	
+	portYIELD_FROM_ISR(woken);
 }
 
 void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
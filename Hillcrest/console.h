@@ -21,6 +21,75 @@
 
 #include "stm32f4xx_hal.h"
 
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Size of transmit ring buffer.  (Override at build time to trade RAM for
+// burst capacity.)
+#ifndef CONSOLE_TXBUFLEN
+#define CONSOLE_TXBUFLEN (1024)
+#endif
+
+// Who produced a record, for drop accounting
+typedef enum {
+	CONSOLE_SRC_STDIO = 0,    // printf and friends
+	CONSOLE_SRC_SENSOR,       // sensor event output
+	CONSOLE_NUM_SOURCES
+} console_source_t;
+
+// Record priority.  Bulk records may not use the last CONSOLE_TXRESERVE
+// bytes of the transmit buffer.
+typedef enum {
+	CONSOLE_PRIO_BULK = 0,
+	CONSOLE_PRIO_HIGH,
+} console_prio_t;
+
+typedef struct console_stats_s {
+	uint32_t txBytes;         // bytes transmitted
+	uint32_t txDmaTransfers;  // DMA transfers (one completion ISR each)
+	uint32_t rxDrops;         // received chars dropped, rx buffer full
+	uint32_t dropRecords[CONSOLE_NUM_SOURCES];  // records dropped, lossy mode
+	uint32_t dropBytes[CONSOLE_NUM_SOURCES];    // bytes in those records
+} console_stats_t;
+
 void console_init(UART_HandleTypeDef* huart);
 
+// Write a block of bytes to the console, expanding LF to CR-LF.
+// Blocks until all of it is queued for transmit.  Returns bytes consumed.
+// In lossy mode the block is written as a high priority stdio record.
+size_t console_write(const void *pData, size_t len);
+
+// Write a complete record (one or more whole lines).
+// In lossy mode a record that doesn't fit is dropped entirely, counted
+// against source, and 0 is returned.  Otherwise blocks like console_write.
+size_t console_writeRecord(const void *pData, size_t len,
+                           console_source_t source, console_prio_t prio);
+
+// Write a binary frame as a record, byte for byte (no CR-LF expansion).
+size_t console_writeFrame(const void *pData, size_t len,
+                          console_source_t source, console_prio_t prio);
+
+// Wait until everything queued so far has left the UART.
+void console_flush(void);
+
+// Select lossy (true) or blocking (false) transmit.
+void console_setLossy(bool lossy);
+
+// Baud rate the UART will actually run at for a requested rate, given the
+// current clock configuration.  Returns 0 if the rate is out of range.
+uint32_t console_actualBaud(uint32_t baud);
+
+// Print achievable rates and their error for the current clock setup.
+void console_printBaudRates(void);
+
+// Change baud rate at runtime: announce the change, drain pending output,
+// reconfigure, then wait for the host to confirm by sending a character at
+// the new rate.  Reverts if no confirmation arrives.  Call only from the
+// task that reads the console.  Returns 0 on success.
+int console_setBaud(uint32_t baud);
+
+// Read a snapshot of the console transmit/receive counters.
+void console_getStats(console_stats_t *pStats);
+
 #endif
@@ -0,0 +1,261 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "cpu_stats.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "timebase.h"
+#include "prof.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define ARRAY_LEN(a) (sizeof(a)/sizeof((a)[0]))
+
+// --- Type Definitions ---------------------------------------------------
+
+typedef struct isrStats_s {
+	// Written by the handler only, in cycle counter counts
+	volatile uint32_t calls;
+	volatile uint64_t time;
+	volatile uint32_t max;      // zeroed by the reader
+} isrStats_t;
+
+typedef struct sleepStats_s {
+	// Written by the idle task only
+	uint32_t start_us;
+	uint32_t sleeps;
+	uint32_t time_us;
+	uint32_t max_us;   // zeroed by the reader
+} sleepStats_t;
+
+// A task's counter when last printed
+typedef struct taskMark_s {
+	TaskHandle_t handle;
+	uint32_t runTime_us;
+} taskMark_t;
+
+// --- Private Data --------------------------------------------------------
+
+static isrStats_t isrStats[CPU_NUM_ISRS];
+static sleepStats_t sleepStats;
+
+static const char * const isrNames[CPU_NUM_ISRS] = {
+	"SysTick",
+	"TIM1",
+	"TIM2",
+	"I2C1_EV",
+	"I2C1_ER",
+	"I2C1 DMA",
+	"USART2",
+	"USART2 DMA",
+	"EXTI15_10",
+	"EXTI9_5",
+};
+
+static const char * const stateNames[] = {
+	"Running",
+	"Ready",
+	"Blocked",
+	"Suspend",
+	"Deleted",
+};
+
+// Counters at the previous top, all zero at boot
+static uint32_t lastPrint_us;
+static taskMark_t lastTask[CPU_STATS_MAX_TASKS];
+static unsigned lastTasks;
+static uint32_t lastIsrCalls[CPU_NUM_ISRS];
+static uint64_t lastIsrTime[CPU_NUM_ISRS];
+#if configUSE_TICKLESS_IDLE == 1
+static uint32_t lastSleeps;
+static uint32_t lastSleep_us;
+#endif
+
+// Too big for the shell's stack
+static TaskStatus_t status[CPU_STATS_MAX_TASKS];
+
+// --- Forward Declarations ------------------------------------------------
+
+static uint32_t lastRunTime(TaskHandle_t handle);
+static void printShare(uint32_t part, uint32_t whole, int width);
+
+// --- Public API ----------------------------------------------------------
+
+uint32_t cpuStats_isrEnter(void)
+{
+	return prof_begin();
+}
+
+void cpuStats_isrExit(cpuStats_isr_t isr, uint32_t start)
+{
+	isrStats_t *pStats = &isrStats[isr];
+	uint32_t elapsed = prof_end((prof_scope_t)(PROF_ISR_FIRST + isr), start);
+
+	pStats->calls++;
+	pStats->time += elapsed;
+	if (elapsed > pStats->max) {
+		pStats->max = elapsed;
+	}
+}
+
+const char *cpuStats_isrName(cpuStats_isr_t isr)
+{
+	return (isr < CPU_NUM_ISRS) ? isrNames[isr] : "?";
+}
+
+void cpuStats_sleepBegin(void)
+{
+	sleepStats.start_us = timebase_now32();
+}
+
+uint32_t cpuStats_sleepEnd(void)
+{
+	uint32_t slept = timebase_now32() - sleepStats.start_us;
+
+	sleepStats.sleeps++;
+	sleepStats.time_us += slept;
+	if (slept > sleepStats.max_us) {
+		sleepStats.max_us = slept;
+	}
+
+	return slept;
+}
+
+void cpuStats_printTop(void)
+{
+	taskMark_t mark[CPU_STATS_MAX_TASKS];
+	UBaseType_t count;
+	uint32_t now_us = timebase_now32();
+	uint32_t elapsed_us = now_us - lastPrint_us;
+	uint32_t taskTotal_us = 0;
+	uint32_t isrTotal_us = 0;
+	unsigned isrsShown = 0;
+
+	if (uxTaskGetNumberOfTasks() > CPU_STATS_MAX_TASKS) {
+		printf("More than %u tasks, raise CPU_STATS_MAX_TASKS.\n",
+		       CPU_STATS_MAX_TASKS);
+		return;
+	}
+	count = uxTaskGetSystemState(status, CPU_STATS_MAX_TASKS, 0);
+	if (elapsed_us == 0) {
+		elapsed_us = 1;
+	}
+
+	// Change since the previous top, busiest first
+	for (unsigned n = 0; n < count; n++) {
+		mark[n].handle = status[n].xHandle;
+		mark[n].runTime_us = status[n].ulRunTimeCounter;
+		status[n].ulRunTimeCounter -= lastRunTime(status[n].xHandle);
+	}
+	for (unsigned n = 1; n < count; n++) {
+		TaskStatus_t task = status[n];
+		unsigned m = n;
+		while ((m > 0) && (status[m-1].ulRunTimeCounter < task.ulRunTimeCounter)) {
+			status[m] = status[m-1];
+			m--;
+		}
+		status[m] = task;
+	}
+
+	printf("  Task             State   Prio     CPU  Stack free\n");
+	for (unsigned n = 0; n < count; n++) {
+		const TaskStatus_t *pTask = &status[n];
+		unsigned state = pTask->eCurrentState;
+
+		printf("  %-16s %-7s %4u ", pTask->pcTaskName,
+		       (state < ARRAY_LEN(stateNames)) ? stateNames[state] : "?",
+		       (unsigned)pTask->uxCurrentPriority);
+		printShare(pTask->ulRunTimeCounter, elapsed_us, 7);
+		printf("  %u words\n", pTask->usStackHighWaterMark);
+		taskTotal_us += pTask->ulRunTimeCounter;
+	}
+
+	for (unsigned n = 0; n < CPU_NUM_ISRS; n++) {
+		isrStats_t *pStats = &isrStats[n];
+
+		// One handler's counters at once: the time is two words
+		taskENTER_CRITICAL();
+		uint32_t calls = pStats->calls;
+		uint64_t time = pStats->time;
+		uint32_t max = pStats->max;
+		pStats->max = 0;
+		taskEXIT_CRITICAL();
+
+		uint32_t time_us = (uint32_t)(prof_toNs(time - lastIsrTime[n]) / 1000);
+		if (calls != lastIsrCalls[n]) {
+			if (isrsShown++ == 0) {
+				printf("  ISR                Calls     CPU  Max\n");
+			}
+			printf("  %-12s %10u ", isrNames[n], calls - lastIsrCalls[n]);
+			printShare(time_us, elapsed_us, 7);
+			printf("  %u us\n", (uint32_t)(prof_toNs(max) / 1000));
+		}
+		isrTotal_us += time_us;
+		lastIsrCalls[n] = calls;
+		lastIsrTime[n] = time;
+	}
+
+	printf("Over %u ms: tasks ", elapsed_us / 1000);
+	printShare(taskTotal_us, elapsed_us, 0);
+	printf(", ISRs ");
+	printShare(isrTotal_us, elapsed_us, 0);
+	printf(" (within the tasks' time).\n");
+
+#if configUSE_TICKLESS_IDLE == 1
+	// Wakeups from sleep, and the share of time asleep
+	uint32_t sleeps = sleepStats.sleeps;
+	uint32_t sleep_us = sleepStats.time_us;
+	uint32_t maxSleep_us = sleepStats.max_us;
+	sleepStats.max_us = 0;
+
+	printf("Sleep: %u wakeups/s, asleep ",
+	       (uint32_t)((uint64_t)(sleeps - lastSleeps) * 1000000 / elapsed_us));
+	printShare(sleep_us - lastSleep_us, elapsed_us, 0);
+	printf(", longest %u us.\n", maxSleep_us);
+	lastSleeps = sleeps;
+	lastSleep_us = sleep_us;
+#endif
+
+	memcpy(lastTask, mark, count * sizeof(mark[0]));
+	lastTasks = count;
+	lastPrint_us = now_us;
+}
+
+// --- Private functions ---------------------------------------------------
+
+// A task's counter at the previous top, 0 if it is new since.
+static uint32_t lastRunTime(TaskHandle_t handle)
+{
+	for (unsigned n = 0; n < lastTasks; n++) {
+		if (lastTask[n].handle == handle) {
+			return lastTask[n].runTime_us;
+		}
+	}
+
+	return 0;
+}
+
+// Print part/whole as a percentage, to 0.1%, right aligned in width.
+static void printShare(uint32_t part, uint32_t whole, int width)
+{
+	uint32_t permille = (uint32_t)(((uint64_t)part * 1000 + whole/2) / whole);
+
+	printf("%*u.%u%%", (width > 3) ? width - 3 : 1, permille / 10, permille % 10);
+}
@@ -0,0 +1,73 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef CPU_STATS_H
+#define CPU_STATS_H
+
+// Where the CPU goes: per task and per interrupt.
+//
+// FreeRTOS keeps the task run times on the TIM2 1us timebase
+// (configGENERATE_RUN_TIME_STATS), charging each interrupt to the task it
+// preempted.  The handlers in stm32f4xx_it.c bracket themselves with
+// cpuStats_isrEnter/Exit to break that time out, timed to the cycle on
+// the profiler's counter (prof.h), which also keeps their histograms.
+
+#include <stdint.h>
+
+typedef enum {
+	CPU_ISR_SYSTICK,     // RTOS tick
+	CPU_ISR_TIM1,        // HAL tick
+	CPU_ISR_TIM2,        // timebase, INTN capture, wait deadlines
+	CPU_ISR_I2C1_EV,
+	CPU_ISR_I2C1_ER,
+	CPU_ISR_I2C1_DMA,    // DMA1 stream 0, I2C1 RX
+	CPU_ISR_USART2,
+	CPU_ISR_USART2_DMA,  // DMA1 stream 6, USART2 TX
+	CPU_ISR_EXTI15_10,   // INTN of unit 0
+	CPU_ISR_EXTI9_5,     // INTN of unit 1
+	CPU_NUM_ISRS
+} cpuStats_isr_t;
+
+// Tasks the top view has room for, the idle task included
+#ifndef CPU_STATS_MAX_TASKS
+#define CPU_STATS_MAX_TASKS (8)
+#endif
+
+// First thing in a handler.  Pass the result to cpuStats_isrExit.
+uint32_t cpuStats_isrEnter(void);
+
+// Last thing in a handler: count one call of isr, started at start (DWT
+// cycle counter).
+void cpuStats_isrExit(cpuStats_isr_t isr, uint32_t start);
+
+// Name of an interrupt, as top shows it.
+const char *cpuStats_isrName(cpuStats_isr_t isr);
+
+// Tickless idle: bracket each sleep, from the pre and post sleep hooks.
+// cpuStats_sleepEnd returns the time asleep (us).
+void cpuStats_sleepBegin(void);
+uint32_t cpuStats_sleepEnd(void);
+
+// Print each task's state, priority, CPU share and least free stack, then
+// each interrupt's calls, CPU share and longest run, then with tickless
+// idle the wakeups from sleep and time asleep.  Shares and maxima cover
+// the time since the previous call (since boot, the first time).  Call at
+// least once an hour: the counters are 32-bit microseconds.
+void cpuStats_printTop(void);
+
+#endif
@@ -0,0 +1,156 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+// Integer-only fixed point formatting
+
+#include "fixfmt.h"
+
+#include <stdbool.h>
+
+// ------------------------------------------------------------------------
+// Private data
+
+static const uint32_t pow10[FIXFMT_MAX_DECIMALS+1] = {
+	1, 10, 100, 1000, 10000, 100000, 1000000,
+};
+
+// ------------------------------------------------------------------------
+// Forward declarations
+
+static char *fmtFixed(char *p, bool neg, uint64_t mag,
+                      unsigned q, unsigned decimals);
+static char *fmtDigits(char *p, uint32_t v, unsigned width);
+
+// ------------------------------------------------------------------------
+// Public API
+
+char *fixfmt_str(char *p, const char *s)
+{
+	while (*s) {
+		*p++ = *s++;
+	}
+	*p = 0;
+
+	return p;
+}
+
+char *fixfmt_int(char *p, int32_t v)
+{
+	if (v < 0) {
+		*p++ = '-';
+		return fmtDigits(p, -(uint32_t)v, 1);
+	}
+
+	return fmtDigits(p, v, 1);
+}
+
+char *fixfmt_uint(char *p, uint32_t v)
+{
+	return fmtDigits(p, v, 1);
+}
+
+char *fixfmt_q(char *p, int64_t v, unsigned q, unsigned decimals)
+{
+	bool neg = (v < 0);
+	uint64_t mag = neg ? -(uint64_t)v : (uint64_t)v;
+
+	return fmtFixed(p, neg, mag, q, decimals);
+}
+
+char *fixfmt_qFloat(char *p, int64_t v, unsigned q, unsigned decimals)
+{
+	bool neg = (v < 0);
+	uint64_t mag = neg ? -(uint64_t)v : (uint64_t)v;
+	unsigned shift = 0;
+
+	// Round to a 24 bit significand, ties to even, like a float would.
+	while ((mag >> shift) >= (1UL << 24)) {
+		shift++;
+	}
+	if (shift > 0) {
+		uint64_t half = (uint64_t)1 << (shift-1);
+		uint64_t rem = mag & (((uint64_t)1 << shift) - 1);
+		mag >>= shift;
+		if ((rem > half) || ((rem == half) && (mag & 1))) {
+			mag++;
+		}
+		mag <<= shift;
+	}
+
+	return fmtFixed(p, neg, mag, q, decimals);
+}
+
+char *fixfmt_time_us(char *p, uint64_t t_us)
+{
+	p = fmtDigits(p, (uint32_t)(t_us / 1000000), 1);
+	*p++ = '.';
+	return fmtDigits(p, (uint32_t)(t_us % 1000000), 6);
+}
+
+// ------------------------------------------------------------------------
+// Private utility functions
+
+// Format mag / 2^q, correctly rounded to the given number of decimals.
+// The rounded result must fit in 32 bits once scaled by 10^decimals.
+static char *fmtFixed(char *p, bool neg, uint64_t mag,
+                      unsigned q, unsigned decimals)
+{
+	uint64_t scaled = mag * pow10[decimals];
+	uint32_t quot = (uint32_t)(scaled >> q);
+
+	if (q > 0) {
+		uint64_t half = (uint64_t)1 << (q-1);
+		uint64_t rem = scaled & (((uint64_t)1 << q) - 1);
+		if ((rem > half) || ((rem == half) && (quot & 1))) {
+			quot++;
+		}
+	}
+
+	if (neg) {
+		*p++ = '-';
+	}
+	p = fmtDigits(p, quot / pow10[decimals], 1);
+	if (decimals > 0) {
+		*p++ = '.';
+		p = fmtDigits(p, quot % pow10[decimals], decimals);
+	}
+
+	return p;
+}
+
+// Decimal digits of v, zero padded to at least width digits.
+static char *fmtDigits(char *p, uint32_t v, unsigned width)
+{
+	char tmp[10];
+	unsigned len = 0;
+
+	do {
+		tmp[len++] = '0' + (v % 10);
+		v /= 10;
+	} while (v != 0);
+	while (len < width) {
+		tmp[len++] = '0';
+	}
+
+	while (len > 0) {
+		*p++ = tmp[--len];
+	}
+	*p = 0;
+
+	return p;
+}
@@ -0,0 +1,53 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef FIXFMT_H
+#define FIXFMT_H
+
+// Integer-only number formatting for the event printers.
+//
+// Each function renders into the caller's buffer at p, NUL terminates it
+// and returns a pointer to the terminator so calls can be chained.  Output
+// matches printf("%d"), printf("%u") and printf("%0.<decimals>f") of the
+// equivalent float, including round-half-even on exact ties and "-0.000"
+// for small negative values.  No floating point or varargs are used.
+
+#include <stdint.h>
+
+// Largest number of decimals supported
+#define FIXFMT_MAX_DECIMALS (6)
+
+// 180/pi as the float the printers used to compute (15019745 / 2^18)
+#define FIXFMT_RAD_TO_DEG_MANT (15019745)
+#define FIXFMT_RAD_TO_DEG_Q    (18)
+
+char *fixfmt_str(char *p, const char *s);
+char *fixfmt_int(char *p, int32_t v);
+char *fixfmt_uint(char *p, uint32_t v);
+
+// v / 2^q with the given number of decimals.
+char *fixfmt_q(char *p, int64_t v, unsigned q, unsigned decimals);
+
+// v / 2^q, first rounded to single precision float, with the given number
+// of decimals.  Matches printing a float computed from a product of floats.
+char *fixfmt_qFloat(char *p, int64_t v, unsigned q, unsigned decimals);
+
+// Microsecond timestamp as seconds with six decimals.
+char *fixfmt_time_us(char *p, uint64_t t_us);
+
+#endif
@@ -0,0 +1,103 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "intn_fifo.h"
+
+#include "stm32f4xx_hal.h"
+
+#if (INTN_FIFO_LEN & (INTN_FIFO_LEN - 1)) != 0
+#error INTN_FIFO_LEN must be a power of two
+#endif
+
+// ------------------------------------------------------------------------
+// Public API
+
+void intnFifo_init(intnFifo_t *pFifo)
+{
+	pFifo->head = 0;
+	pFifo->tail = 0;
+	pFifo->edges = 0;
+	pFifo->overflows = 0;
+	pFifo->highWater = 0;
+	pFifo->unmatchedEdges = 0;
+	pFifo->unmatchedReads = 0;
+}
+
+bool intnFifo_push(intnFifo_t *pFifo, uint32_t timestamp_us, uint32_t sequence)
+{
+	uint32_t head = pFifo->head;
+	uint32_t count = head - pFifo->tail;
+
+	pFifo->edges++;
+	if (count >= INTN_FIFO_LEN) {
+		// Keep the edges already waiting; their reads are still coming.
+		pFifo->overflows++;
+		return false;
+	}
+
+	intnEdge_t *pEdge = &pFifo->edge[head & (INTN_FIFO_LEN - 1)];
+	pEdge->timestamp_us = timestamp_us;
+	pEdge->sequence = sequence;
+
+	// Entry must be visible before the new head
+	__DMB();
+	pFifo->head = head + 1;
+
+	if (count + 1 > pFifo->highWater) {
+		pFifo->highWater = count + 1;
+	}
+
+	return true;
+}
+
+bool intnFifo_pop(intnFifo_t *pFifo, intnEdge_t *pEdge)
+{
+	uint32_t tail = pFifo->tail;
+
+	if (pFifo->head == tail) {
+		pFifo->unmatchedReads++;
+		return false;
+	}
+
+	// Read the entry only after seeing the head that published it
+	__DMB();
+	*pEdge = pFifo->edge[tail & (INTN_FIFO_LEN - 1)];
+
+	// and finish with it before handing the slot back.
+	__DMB();
+	pFifo->tail = tail + 1;
+
+	return true;
+}
+
+void intnFifo_flush(intnFifo_t *pFifo)
+{
+	uint32_t head = pFifo->head;
+
+	pFifo->unmatchedEdges += head - pFifo->tail;
+	pFifo->tail = head;
+}
+
+void intnFifo_getStats(const intnFifo_t *pFifo, intnFifo_stats_t *pStats)
+{
+	pStats->edges = pFifo->edges;
+	pStats->overflows = pFifo->overflows;
+	pStats->unmatchedEdges = pFifo->unmatchedEdges;
+	pStats->unmatchedReads = pFifo->unmatchedReads;
+	pStats->highWater = pFifo->highWater;
+}
@@ -0,0 +1,81 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef INTN_FIFO_H
+#define INTN_FIFO_H
+
+// Lock-free single producer, single consumer ring of INTN edges.
+//
+// The EXTI ISR pushes a (timestamp, sequence) pair for every edge.  The
+// task pops one edge for every HID read, so each report is timestamped by
+// the edge that announced it even if more edges arrive before the driver
+// asks for the time.  Indices run freely and only the producer writes
+// head, only the consumer writes tail.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Edges buffered per unit.  Must be a power of two.
+#ifndef INTN_FIFO_LEN
+#define INTN_FIFO_LEN (8)
+#endif
+
+typedef struct intnEdge_s {
+	uint32_t timestamp_us;
+	uint32_t sequence;
+} intnEdge_t;
+
+typedef struct intnFifo_stats_s {
+	uint32_t edges;           // edges captured
+	uint32_t overflows;       // edges lost, ring full
+	uint32_t unmatchedEdges;  // edges discarded unread by a reset
+	uint32_t unmatchedReads;  // reads with no edge to match
+	unsigned highWater;       // most edges waiting at once
+} intnFifo_stats_t;
+
+typedef struct intnFifo_s {
+	intnEdge_t edge[INTN_FIFO_LEN];
+	volatile uint32_t head;   // producer (ISR) only
+	volatile uint32_t tail;   // consumer (task) only
+
+	// Producer counters
+	volatile uint32_t edges;
+	volatile uint32_t overflows;
+	volatile unsigned highWater;
+
+	// Consumer counters
+	uint32_t unmatchedEdges;
+	uint32_t unmatchedReads;
+} intnFifo_t;
+
+void intnFifo_init(intnFifo_t *pFifo);
+
+// Record an edge.  Call from the producer (ISR) only.
+// Returns false if the ring was full and the edge was lost.
+bool intnFifo_push(intnFifo_t *pFifo, uint32_t timestamp_us, uint32_t sequence);
+
+// Take the oldest edge to match a read.  Call from the consumer only.
+// Returns false, leaving *pEdge alone, if no edge is waiting.
+bool intnFifo_pop(intnFifo_t *pFifo, intnEdge_t *pEdge);
+
+// Discard waiting edges, e.g. on reset.  Call from the consumer only.
+void intnFifo_flush(intnFifo_t *pFifo);
+
+void intnFifo_getStats(const intnFifo_t *pFifo, intnFifo_stats_t *pStats);
+
+#endif
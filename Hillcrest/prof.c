@@ -0,0 +1,182 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "prof.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "stm32f4xx_hal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+// --- Type Definitions ---------------------------------------------------
+
+typedef struct profScope_s {
+	uint32_t count;
+	uint32_t min;              // counts
+	uint32_t max;
+	uint64_t total;
+	uint32_t bins[PROF_BINS];
+} profScope_t;
+
+// --- Private Data --------------------------------------------------------
+
+static profScope_t scopes[PROF_NUM_SCOPES];
+
+// Upper bound of the first bin, in counts
+static uint32_t bin0 = 1;
+
+static const char * const scopeNames[PROF_ISR_FIRST] = {
+	"sh_getEvent",
+	"shdev_i2c",
+	"printEvent",
+	"printDsf",
+	"printBinary",
+};
+
+// --- Forward Declarations ------------------------------------------------
+
+static void resetScopes(void);
+static void histogram(const profScope_t *pScope, char *buf, size_t len);
+
+// --- Public API ----------------------------------------------------------
+
+void prof_init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	bin0 = (uint32_t)((uint64_t)PROF_BIN0_NS * SystemCoreClock / 1000000000);
+	if (bin0 == 0) {
+		bin0 = 1;
+	}
+
+	// Before the scheduler a critical section would leave interrupts
+	// masked, so no lock here.
+	resetScopes();
+}
+
+uint32_t prof_begin(void)
+{
+	return DWT->CYCCNT;
+}
+
+uint32_t prof_end(prof_scope_t scope, uint32_t start)
+{
+	uint32_t elapsed = DWT->CYCCNT - start;
+	profScope_t *pScope = &scopes[scope];
+	unsigned bin = 0;
+
+	for (uint32_t bound = bin0; (bin < PROF_BINS - 1) && (elapsed >= bound); bound <<= 1) {
+		bin++;
+	}
+
+	pScope->count++;
+	pScope->total += elapsed;
+	if (elapsed < pScope->min) {
+		pScope->min = elapsed;
+	}
+	if (elapsed > pScope->max) {
+		pScope->max = elapsed;
+	}
+	pScope->bins[bin]++;
+
+	return elapsed;
+}
+
+uint64_t prof_toNs(uint64_t counts)
+{
+	return counts * 1000000000 / SystemCoreClock;
+}
+
+void prof_print(void)
+{
+	profScope_t scope;
+	char bins[PROF_BINS * 14];
+
+	printf("  Scope            Count      Min     Mean      Max (ns)\n");
+	for (unsigned n = 0; n < PROF_NUM_SCOPES; n++) {
+		// A consistent copy: handlers update theirs at any time
+		taskENTER_CRITICAL();
+		scope = scopes[n];
+		taskEXIT_CRITICAL();
+		if (scope.count == 0) {
+			continue;
+		}
+
+		printf("  %-12s %9u %8u %8u %8u\n",
+		       (n < PROF_ISR_FIRST) ? scopeNames[n] :
+		           cpuStats_isrName((cpuStats_isr_t)(n - PROF_ISR_FIRST)),
+		       scope.count,
+		       (uint32_t)prof_toNs(scope.min),
+		       (uint32_t)prof_toNs(scope.total / scope.count),
+		       (uint32_t)prof_toNs(scope.max));
+
+		histogram(&scope, bins, sizeof(bins));
+		printf("   %s\n", bins);
+	}
+	printf("Counter at %u Hz.\n", (unsigned)SystemCoreClock);
+}
+
+void prof_clear(void)
+{
+	taskENTER_CRITICAL();
+	resetScopes();
+	taskEXIT_CRITICAL();
+}
+
+// --- Private functions ---------------------------------------------------
+
+static void resetScopes(void)
+{
+	memset(scopes, 0, sizeof(scopes));
+	for (unsigned n = 0; n < PROF_NUM_SCOPES; n++) {
+		scopes[n].min = UINT32_MAX;
+	}
+}
+
+// The bins in use, each as " <bound:count", the last as " >=bound:count".
+static void histogram(const profScope_t *pScope, char *buf, size_t len)
+{
+	size_t used = 0;
+
+	buf[0] = 0;
+	for (unsigned bin = 0; (bin < PROF_BINS) && (used < len); bin++) {
+		bool last = (bin == PROF_BINS - 1);
+		uint32_t ns = PROF_BIN0_NS << (last ? bin - 1 : bin);
+		const char *op = last ? ">=" : "<";
+
+		if (pScope->bins[bin] == 0) {
+			continue;
+		}
+		if (ns < 1000) {
+			used += snprintf(buf + used, len - used, " %s%uns:%u",
+			                 op, ns, pScope->bins[bin]);
+		}
+		else if (ns < 1000000) {
+			used += snprintf(buf + used, len - used, " %s%uus:%u",
+			                 op, ns / 1000, pScope->bins[bin]);
+		}
+		else {
+			used += snprintf(buf + used, len - used, " %s%u.%ums:%u",
+			                 op, ns / 1000000, ns / 100000 % 10, pScope->bins[bin]);
+		}
+	}
+}
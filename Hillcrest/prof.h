@@ -0,0 +1,72 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef PROF_H
+#define PROF_H
+
+// Named profiling scopes on the DWT cycle counter.
+//
+// Bracket a hot path with prof_begin/prof_end.  Each scope keeps a count,
+// min, max, total and a histogram of durations in powers of two, in a
+// fixed table that the console dumps on demand.  The interrupt handlers'
+// scopes are kept by cpuStats_isrEnter/Exit.
+//
+// The host build's DWT counts its monotonic clock in ns (a 1 GHz "core"),
+// so the same scopes report comparable times on the desktop.  A scope
+// must not run for longer than the counter takes to wrap: 51 s at 84 MHz.
+
+#include <stdint.h>
+
+#include "cpu_stats.h"
+
+typedef enum {
+	PROF_SH_GET_EVENT,    // read and decode one report
+	PROF_SHDEV_I2C,       // one I2C transfer, bus wait and retries included
+	PROF_PRINT_EVENT,     // format and write one event: text
+	PROF_PRINT_DSF,       //   DSF
+	PROF_PRINT_BINARY,    //   binary
+	PROF_ISR_FIRST,       // one scope per cpuStats_isr_t from here
+	PROF_NUM_SCOPES = PROF_ISR_FIRST + CPU_NUM_ISRS
+} prof_scope_t;
+
+// Histogram bins: the first holds durations under PROF_BIN0_NS, each next
+// one durations up to twice as long, the last anything longer.
+#define PROF_BINS (16)
+#define PROF_BIN0_NS (500)
+
+// Start the cycle counter.  Call once SystemCoreClock is set.
+void prof_init(void);
+
+// Start of a scope.  Pass the result to prof_end.
+uint32_t prof_begin(void);
+
+// End of a scope that began at start.  Returns its duration in counts.
+// A scope is ended from one task or handler at a time.
+uint32_t prof_end(prof_scope_t scope, uint32_t start);
+
+// Counts of the cycle counter in ns.
+uint64_t prof_toNs(uint64_t counts);
+
+// Print each scope that ran: count, min, mean and max (ns), then its
+// histogram.
+void prof_print(void);
+
+// Forget everything so far.
+void prof_clear(void);
+
+#endif
@@ -0,0 +1,27 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+// The kernel's allocator: FreeRTOS's heap_4, or with STATIC_RTOS_ALLOC
+// the module pools in rtos_pool.c.  The project builds this file in place
+// of heap_4.c so that one define switches between them.
+
+#include "rtos_pool.h"
+
+#ifndef STATIC_RTOS_ALLOC
+#include "../Middlewares/Third_Party/FreeRTOS/Source/portable/MemMang/heap_4.c"
+#endif
@@ -0,0 +1,123 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "rtos_pool.h"
+
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+// --- Private Data --------------------------------------------------------
+
+// The idle task
+RTOS_POOL(kernelPool, "kernel", RTOS_TASK_BYTES(configMINIMAL_STACK_SIZE));
+
+// Pools begun so far, kernel first
+static rtosPool_t *pPools = &kernelPool;
+
+// Pool serving allocations now
+static rtosPool_t *pCurrent = &kernelPool;
+
+// --- Public API ----------------------------------------------------------
+
+void rtosPool_begin(rtosPool_t *pPool)
+{
+	rtosPool_t **ppTail = &pPools;
+
+	while ((*ppTail != 0) && (*ppTail != pPool)) {
+		ppTail = &(*ppTail)->pNext;
+	}
+	if (*ppTail == 0) {
+		*ppTail = pPool;
+	}
+
+	pPool->heapMark = xPortGetFreeHeapSize();
+	pCurrent = pPool;
+}
+
+void rtosPool_end(void)
+{
+#ifndef STATIC_RTOS_ALLOC
+	pCurrent->used += pCurrent->heapMark - xPortGetFreeHeapSize();
+#endif
+	pCurrent = &kernelPool;
+}
+
+void rtosPool_print(void)
+{
+#ifdef STATIC_RTOS_ALLOC
+	printf("  Pool         Budget    Used\n");
+	for (rtosPool_t *pPool = pPools; pPool != 0; pPool = pPool->pNext) {
+		printf("  %-10s %8u %7u%s\n", pPool->name,
+		       (unsigned)pPool->size, (unsigned)pPool->used,
+		       (pPool->used > pPool->size) ? "  over budget" : "");
+	}
+	printf("Static allocation: no heap.\n");
+#else
+	// Heap use includes heap_4's 8 byte block headers, so it runs a little
+	// over the budgets.  The kernel's objects are not bracketed.
+	printf("  Pool         Budget    Heap\n");
+	for (rtosPool_t *pPool = pPools; pPool != 0; pPool = pPool->pNext) {
+		if (pPool != &kernelPool) {
+			printf("  %-10s %8u %7u\n", pPool->name,
+			       (unsigned)pPool->size, (unsigned)pPool->used);
+		}
+	}
+	printf("Heap: %u of %u bytes free, least %u.\n",
+	       (unsigned)xPortGetFreeHeapSize(), (unsigned)configTOTAL_HEAP_SIZE,
+	       (unsigned)xPortGetMinimumEverFreeHeapSize());
+#endif
+}
+
+#ifdef STATIC_RTOS_ALLOC
+// The kernel's allocator, in place of heap_4 (see rtos_heap.c)
+
+void *pvPortMalloc(size_t size)
+{
+	void *p = 0;
+
+	size = RTOS_ALIGN(size);
+
+	vTaskSuspendAll();
+	if (pCurrent->used + size <= pCurrent->size) {
+		p = pCurrent->base + pCurrent->used;
+	}
+	// Count a miss too: used shows what the budget lacks.
+	pCurrent->used += size;
+	(void)xTaskResumeAll();
+
+	configASSERT(p != 0);
+	return p;
+}
+
+void vPortFree(void *p)
+{
+	// Nothing is deleted, and pools are never reused.
+}
+
+size_t xPortGetFreeHeapSize(void)
+{
+	return 0;
+}
+
+size_t xPortGetMinimumEverFreeHeapSize(void)
+{
+	return 0;
+}
+#endif
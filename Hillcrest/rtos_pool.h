@@ -0,0 +1,83 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef RTOS_POOL_H
+#define RTOS_POOL_H
+
+// Per-module budgets for the kernel objects each module creates.
+//
+// Each module that creates tasks, queues or semaphores declares a pool
+// sized for them with RTOS_POOL and brackets its create calls with
+// rtosPool_begin/rtosPool_end.  By default heap_4 serves the allocations
+// and the pool just records how much of the heap the module took.
+//
+// Define STATIC_RTOS_ALLOC to place every kernel object in its module's
+// pool instead.  (FreeRTOS 8.2.1 predates static creation.)  The pools are
+// then ordinary arrays in each module's RAM, so the linker map fixes the
+// RAM map.  See Tools/ram_budget.c.  rtos_heap.c then drops heap_4.
+// Objects created outside a begin/end pair, the idle task, come from the
+// kernel's pool.  An allocation that does not fit its pool asserts.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// #define STATIC_RTOS_ALLOC
+
+// Object sizes on the target: FreeRTOS 8.2.1 on the Cortex-M4, with this
+// FreeRTOSConfig.h (trace facility, run time stats).  Every allocation is
+// rounded up to 8 bytes.
+#define RTOS_TCB_SIZE   (96)
+#define RTOS_QUEUE_SIZE (84)
+#define RTOS_ALIGN(n)   (((n) + 7) & ~7)
+
+// Pool bytes for each kind of object
+#define RTOS_TASK_BYTES(stackWords) \
+	(RTOS_ALIGN(RTOS_TCB_SIZE) + RTOS_ALIGN((stackWords) * 4))
+#define RTOS_QUEUE_BYTES(len, itemSize) \
+	RTOS_ALIGN(RTOS_QUEUE_SIZE + (len) * (itemSize) + 1)
+#define RTOS_SEMAPHORE_BYTES  RTOS_ALIGN(RTOS_QUEUE_SIZE)
+#define RTOS_MUTEX_BYTES      RTOS_ALIGN(RTOS_QUEUE_SIZE)
+
+typedef struct rtosPool_s {
+	const char *name;
+	uint8_t *base;              // 0 unless STATIC_RTOS_ALLOC
+	size_t size;                // budget
+	size_t used;
+	size_t heapMark;            // heap free at rtosPool_begin
+	struct rtosPool_s *pNext;   // pools begun so far, for the report
+} rtosPool_t;
+
+// Declare a pool of bytes for a module's kernel objects.
+#ifdef STATIC_RTOS_ALLOC
+#define RTOS_POOL(pool, name, bytes) \
+	static uint64_t pool##_storage[((bytes) + 7) / 8]; \
+	static rtosPool_t pool = { (name), (uint8_t *)pool##_storage, (bytes), 0, 0, 0 }
+#else
+#define RTOS_POOL(pool, name, bytes) \
+	static rtosPool_t pool = { (name), 0, (bytes), 0, 0, 0 }
+#endif
+
+// Kernel objects created from here to rtosPool_end come from pPool.  Pairs
+// don't nest, and only one task may be between them at a time.
+void rtosPool_begin(rtosPool_t *pPool);
+void rtosPool_end(void);
+
+// Print each pool's budget and use, and what is left of the heap.
+void rtosPool_print(void);
+
+#endif
@@ -18,46 +18,186 @@
 
 // Sensor Application
 #include <stdio.h>
+#include <stdbool.h>
 
 #include "sensor_app.h"
 #include "SensorHub.h"
 #include "sh_bno_stm32f401.h"
+#include "console.h"
+#include "fixfmt.h"
+#include "binstream.h"
+#include "timebase.h"
+#include "rtos_pool.h"
+#include "prof.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
 
 #define SENSOR_APP_VERSION "1.1.1"
 
+// Number of events buffered between the sensor and output tasks
+#define EVENT_QUEUE_LEN (32)
+
+// Number of sensor config changes that can be pending
+#define CONFIG_QUEUE_LEN (4)
+
+// Longest the sensor task waits for INTN before checking for config
+// changes (ms)
+#define INTN_WAIT_MS (100)
+
+// Most events read from one hub per wakeup, and how long after a read the
+// hub has to assert INTN again for its batch to go on (us)
+#define EVENT_BATCH_LEN (16)
+#define EVENT_BATCH_GAP_US (200)
+
+// Liveness: a hub is reset when an enabled sensor misses this many
+// reports in a row, or goes this long without one (ms), whichever is
+// longer.  Checked every LIVENESS_CHECK_MS.
+#define LIVENESS_MISSED (10)
+#define LIVENESS_MIN_MS (200)
+#define LIVENESS_CHECK_MS (50)
+
 // Define this to produce DSF data for loggin
 // #define DSF_OUTPUT
 
+// Define this to produce compact binary records, decoded to DSF on the host
+// by Tools/binstream_decode.c.
+// #define BINARY_OUTPUT
+
+// (The output format can also be changed at runtime from the shell.)
+#if defined(DSF_OUTPUT)
+#define INITIAL_OUTPUT SENSOR_APP_OUTPUT_DSF
+#elif defined(BINARY_OUTPUT)
+#define INITIAL_OUTPUT SENSOR_APP_OUTPUT_BINARY
+#else
+#define INITIAL_OUTPUT SENSOR_APP_OUTPUT_TEXT
+#endif
+
 // Define this and the example will perform a firmware update.
 // #define PERFORM_DFU
 
+// Define this to compare per-byte and block console writes at startup.
+// #define CONSOLE_BENCHMARK
+
+#ifdef CONSOLE_BENCHMARK
+#include <string.h>
+#endif
+
 #ifdef PERFORM_DFU
 #include "Firmware.h"
 #include "bno070.h"
 #endif
 
+// --- Type definitions -----------------------------------------------
+
+// Sensor config change, from shell to sensor task
+typedef struct configRequest_s {
+	int sensor;
+	sh_SensorConfig_t config;
+} configRequest_t;
+
+// Event from sensor task to output task, and the hub it came from
+typedef struct hubEvent_s {
+	unsigned unit;
+	sh_SensorEvent_t event;
+} hubEvent_t;
+
+// Throughput of one hub
+typedef struct hubStats_s {
+	volatile uint32_t received;
+	volatile uint32_t dropped;
+	volatile uint32_t errors;     // I2C failures
+} hubStats_t;
+
+// Liveness of one hub: when each sensor last reported, and the outages
+// that ended in a reset
+typedef struct liveness_s {
+	TickType_t lastEvent[SH_MAX_SENSOR_ID+1];
+	bool down;                    // reset, waiting for downSensor
+	int downSensor;
+	TickType_t downSince;         // downSensor's last report before
+	uint32_t resets;
+	uint32_t outages;             // ended by downSensor reporting again
+	uint32_t lastOutage_ms;
+	uint32_t maxOutage_ms;
+	uint32_t totalOutage_ms;
+} liveness_t;
+
+// --- Private data ---------------------------------------------------
+
+// Events from sensor task to output task
+static QueueHandle_t eventQueue;
+
+// Config changes for the sensor task to apply
+static QueueHandle_t configQueue;
+
+RTOS_POOL(appPool, "sensor_app",
+          RTOS_QUEUE_BYTES(EVENT_QUEUE_LEN, sizeof(hubEvent_t)) +
+          RTOS_QUEUE_BYTES(CONFIG_QUEUE_LEN, sizeof(configRequest_t)));
+
+// Hubs serviced by the sensor task
+static void *sensorHub[MAX_SH_UNITS];
+static unsigned numHubs;
+
+// Most recent config applied to each sensor, on every hub
+static sh_SensorConfig_t sensorConfig[SH_MAX_SENSOR_ID+1];
+
+// Output format, and whether its headers still need printing
+static volatile sensorApp_output_t outputMode = INITIAL_OUTPUT;
+static volatile bool headersPending = true;
+
+// Pipeline statistics
+static volatile uint32_t eventsReceived;
+static volatile uint32_t eventsDropped;
+static volatile uint32_t eventsOutput;
+static volatile unsigned queueHighWater;
+static hubStats_t hubStats[MAX_SH_UNITS];
+static TickType_t hubStatsStart;
+
+// Sensor task wakeups with INTN asserted, and the most events one hub gave
+static volatile uint32_t wakeups;
+static volatile unsigned maxBatch;
+static liveness_t liveness[MAX_SH_UNITS];
+
+// From main() to the first rotation vector output (us), 0 until then
+static volatile uint32_t startup_us;
+
 // --- Forward declarations -------------------------------------------
 
 void reportVersions(void);
 void reportProdIds(void *pSensorHub);
-void startReports(void *pSensorHub);
+void startReports(void);
+void applyConfig(int sensor, const sh_SensorConfig_t *pConfig);
+int configureHub(unsigned unit, int sensor, const sh_SensorConfig_t *pConfig);
+void replayConfig(unsigned unit);
+void serviceHub(unsigned unit);
+void queueEvent(unsigned unit, const sh_SensorEvent_t *pEvent);
+void checkLiveness(unsigned unit);
+void resetHub(unsigned unit, int sensor);
 void printDsfHeaders(void);
-void printDsf(const sh_SensorEvent_t *pEvent);
-void printEvent(const sh_SensorEvent_t *pEvent);
+void printDsf(unsigned unit, const sh_SensorEvent_t *pEvent);
+void printEvent(unsigned unit, const sh_SensorEvent_t *pEvent);
+void printBinaryHeaders(void);
+void printBinary(unsigned unit, const sh_SensorEvent_t *pEvent);
+void printWakeStats(const char *name, const bno_wakeStats_t *pStats);
+#ifdef CONSOLE_BENCHMARK
+void benchmarkConsole(void);
+#endif
 
 // --- Public methods -------------------------------------------------
 
 void sensorTask(void)
 {
 	// Initialize stuff
-	int rc = 0;
-	int reports = 0;
-	void *pSensorHub = 0;
-	sh_SensorEvent_t event;
+	configRequest_t request;
+	unsigned first = 0;
+	uint32_t busClears = 0;
+	TickType_t lastCheck;
         
 #ifdef PERFORM_DFU
 	printf("Starting DFU.\n");
-	rc = bno070_performDfu(0, &bno070_firmware);
+	int rc = bno070_performDfu(0, &bno070_firmware);
 	if (rc == 0) {
 		printf("DFU Succeeded.\n");
 	}
@@ -69,45 +209,343 @@ void sensorTask(void)
 	}
 #endif
 
-	// Get reference to sensorhub (unit 0)
-	pSensorHub = sh_init(0);
+#ifdef CONSOLE_BENCHMARK
+	benchmarkConsole();
+#endif
+
+	// Get references to the sensorhubs, all on this task
+	numHubs = bno_numUnits();
+	for (unsigned unit = 0; unit < numHubs; unit++) {
+		sensorHub[unit] = sh_init(unit);
+	}
   
-#ifndef DSF_OUTPUT
-	// Report version of this app, SH-1 library and HAL implementation.
-	reportVersions();
+	if (outputMode == SENSOR_APP_OUTPUT_TEXT) {
+		// Report version of this app, SH-1 library and HAL implementation.
+		reportVersions();
       
-	// Read out product id
-	reportProdIds(pSensorHub);
-#endif
+		// Read out product ids
+		for (unsigned unit = 0; unit < numHubs; unit++) {
+			if (numHubs > 1) {
+				printf("Hub %u:\n", unit);
+			}
+			reportProdIds(sensorHub[unit]);
+		}
+	}
     
 	// Enable reports from Rotation Vector.
-	startReports(pSensorHub);
+	startReports();
+	hubStatsStart = xTaskGetTickCount();
+	lastCheck = hubStatsStart;
 
 	// Process sensors forever
-#ifdef DSF_OUTPUT
-	printDsfHeaders();
-#endif
 	while (1) {
-		// Get an event from the sensorhub
-		rc = sh_getEvent(pSensorHub, &event);
-		if (rc == SH_STATUS_SUCCESS) {
-			reports++;
+		// Apply any config changes requested by the shell
+		while (xQueueReceive(configQueue, &request, 0) == pdPASS) {
+			applyConfig(request.sensor, &request.config);
+		}
 
-#ifdef DSF_OUTPUT
-			printDsf(&event);
-#else
-			printEvent(&event);
-#endif
+		// A bus clear can cost the hubs a command, configure them again
+		if (bno_i2cBusClears() != busClears) {
+			busClears = bno_i2cBusClears();
+			for (unsigned unit = 0; unit < numHubs; unit++) {
+				replayConfig(unit);
+			}
+		}
+
+		// Drain each hub with INTN asserted.  Start one hub further along
+		// each pass so none is always served first.
+		uint32_t asserted = bno_waitIntnAny(INTN_WAIT_MS);
+		if (asserted != 0) {
+			wakeups++;
+		}
+		for (unsigned n = 0; n < numHubs; n++) {
+			unsigned unit = (first + n) % numHubs;
+			if (asserted & (1u << unit)) {
+				serviceHub(unit);
+			}
+		}
+		first = (first + 1) % numHubs;
+
+		// Reset any hub that has stopped reporting
+		if ((xTaskGetTickCount() - lastCheck) >=
+		    timebase_ticksFor(LIVENESS_CHECK_MS * 1000, configTICK_RATE_HZ)) {
+			lastCheck = xTaskGetTickCount();
+			for (unsigned unit = 0; unit < numHubs; unit++) {
+				checkLiveness(unit);
+			}
+		}
+	}
+}
+
+void outputTask(void)
+{
+	hubEvent_t item;
+
+	while (1) {
+		if (xQueueReceive(eventQueue, &item, portMAX_DELAY) == pdPASS) {
+			if (headersPending) {
+				headersPending = false;
+				if (outputMode == SENSOR_APP_OUTPUT_DSF) {
+					printDsfHeaders();
+				}
+				else if (outputMode == SENSOR_APP_OUTPUT_BINARY) {
+					printBinaryHeaders();
+				}
+			}
+			
+			uint32_t start = prof_begin();
+			switch (outputMode) {
+			case SENSOR_APP_OUTPUT_DSF:
+				printDsf(item.unit, &item.event);
+				prof_end(PROF_PRINT_DSF, start);
+				break;
+			case SENSOR_APP_OUTPUT_BINARY:
+				printBinary(item.unit, &item.event);
+				prof_end(PROF_PRINT_BINARY, start);
+				break;
+			default:
+				printEvent(item.unit, &item.event);
+				prof_end(PROF_PRINT_EVENT, start);
+				break;
+			}
+			eventsOutput++;
+
+			if ((startup_us == 0) && (item.event.sensor == SH_ROTATION_VECTOR)) {
+				startup_us = (uint32_t)timebase_sinceMain_us();
+				if (outputMode == SENSOR_APP_OUTPUT_TEXT) {
+					printf("Startup: %u ms from main() to first rotation vector.\n",
+					       startup_us / 1000);
+				}
+			}
 		}
 	}
 }
 
+void sensorApp_init(void)
+{
+	rtosPool_begin(&appPool);
+	eventQueue = xQueueCreate(EVENT_QUEUE_LEN, sizeof(hubEvent_t));
+	configQueue = xQueueCreate(CONFIG_QUEUE_LEN, sizeof(configRequest_t));
+	rtosPool_end();
+
+	eventsReceived = 0;
+	eventsDropped = 0;
+	eventsOutput = 0;
+	queueHighWater = 0;
+	wakeups = 0;
+	maxBatch = 0;
+	for (int unit = 0; unit < MAX_SH_UNITS; unit++) {
+		hubStats[unit].received = 0;
+		hubStats[unit].dropped = 0;
+		hubStats[unit].errors = 0;
+		liveness[unit].down = false;
+		liveness[unit].resets = 0;
+		liveness[unit].outages = 0;
+		liveness[unit].lastOutage_ms = 0;
+		liveness[unit].maxOutage_ms = 0;
+		liveness[unit].totalOutage_ms = 0;
+	}
+}
+
+int sensorApp_setConfig(int sensor, const sh_SensorConfig_t *pConfig)
+{
+	configRequest_t request;
+
+	if ((sensor < 0) || (sensor > SH_MAX_SENSOR_ID)) {
+		return -1;
+	}
+	
+	request.sensor = sensor;
+	request.config = *pConfig;
+	
+	// Sensor task applies it to every hub, within INTN_WAIT_MS.
+	if (xQueueSend(configQueue, &request, 0) != pdPASS) {
+		return -1;
+	}
+
+	return 0;
+}
+
+int sensorApp_getConfig(int sensor, sh_SensorConfig_t *pConfig)
+{
+	if ((sensor < 0) || (sensor > SH_MAX_SENSOR_ID)) {
+		return -1;
+	}
+
+	*pConfig = sensorConfig[sensor];
+	return 0;
+}
+
+unsigned sensorApp_getEvents(unsigned unit, sh_SensorEvent_t *pEvents,
+                             unsigned max)
+{
+	unsigned count = 0;
+
+	while (count < max) {
+		// sh_getEvent would wait for a report, so only read while INTN
+		// says there is one.  Hubs take a moment to assert it again.
+		if (bno_waitIntnUntil(unit, timebase_now32() + EVENT_BATCH_GAP_US) !=
+		    BNO_WAIT_EDGE) {
+			break;
+		}
+
+		uint32_t start = prof_begin();
+		int rc = sh_getEvent(sensorHub[unit], &pEvents[count]);
+		prof_end(PROF_SH_GET_EVENT, start);
+		if (rc != SH_STATUS_SUCCESS) {
+			if (rc == SH_STATUS_ERROR_I2C_IO) {
+				hubStats[unit].errors++;
+			}
+			break;
+		}
+		count++;
+	}
+
+	return count;
+}
+
+void sensorApp_setOutput(sensorApp_output_t mode)
+{
+	outputMode = mode;
+	headersPending = true;
+}
+
+sensorApp_output_t sensorApp_getOutput(void)
+{
+	return outputMode;
+}
+
+void sensorApp_printStats(void)
+{
+	console_stats_t stats;
+	intnFifo_stats_t intn;
+	bno_intnCaptureStats_t capture;
+	bno_wakeStats_t wakeI2c, wakeIntn;
+	bno_i2cRecovery_t recovery;
+	bno_resetStats_t reset;
+	bno_deadlineStats_t deadlines;
+
+	if (startup_us != 0) {
+		printf("Startup: %u ms from main() to first rotation vector.\n",
+		       startup_us / 1000);
+	}
+
+	printf("Events: %u received, %u output, %u dropped.  "
+	       "Queue: %u of %u now, %u max.\n",
+	       eventsReceived, eventsOutput, eventsDropped,
+	       (unsigned)uxQueueMessagesWaiting(eventQueue), EVENT_QUEUE_LEN,
+	       queueHighWater);
+
+	uint32_t elapsed_ms = timebase_ticksToMs(xTaskGetTickCount() - hubStatsStart,
+	                                          configTICK_RATE_HZ);
+	if (wakeups != 0) {
+		uint32_t perWakeup_x100 = (uint32_t)((uint64_t)eventsReceived * 100 / wakeups);
+		printf("Wakeups: %u, %u/s, %u.%02u events each, max %u from one hub.\n",
+		       wakeups,
+		       (elapsed_ms != 0) ? (uint32_t)((uint64_t)wakeups * 1000 / elapsed_ms) : 0,
+		       perWakeup_x100 / 100, perWakeup_x100 % 100, maxBatch);
+	}
+
+	if (numHubs > 1) {
+		for (unsigned unit = 0; unit < numHubs; unit++) {
+			hubStats_t *pHub = &hubStats[unit];
+			printf("Hub %u: %u received, %u dropped, %u errors, %u events/s.\n",
+			       unit, pHub->received, pHub->dropped, pHub->errors,
+			       (elapsed_ms != 0) ?
+			       (uint32_t)((uint64_t)pHub->received * 1000 / elapsed_ms) : 0);
+		}
+	}
+
+	for (unsigned unit = 0; unit < numHubs; unit++) {
+		liveness_t *pLive = &liveness[unit];
+		if (pLive->resets == 0) {
+			continue;
+		}
+		printf("Hub %u liveness: %u resets, %u outages%s, "
+		       "last %u ms, mean %u ms, max %u ms.\n",
+		       unit, pLive->resets, pLive->outages,
+		       pLive->down ? " (one ongoing)" : "",
+		       pLive->lastOutage_ms,
+		       (pLive->outages != 0) ? pLive->totalOutage_ms / pLive->outages : 0,
+		       pLive->maxOutage_ms);
+	}
+
+	unsigned hubs = (numHubs != 0) ? numHubs : 1;
+	for (unsigned unit = 0; unit < hubs; unit++) {
+		bno_getIntnStats(unit, &intn);
+		if (hubs > 1) {
+			printf("Hub %u ", unit);
+		}
+		printf("INTN: %u edges, %u overflowed, %u unmatched edges, "
+		       "%u unmatched reads, %u max waiting.\n",
+		       intn.edges, intn.overflows, intn.unmatchedEdges,
+		       intn.unmatchedReads, intn.highWater);
+
+		bno_getResetStats(unit, &reset);
+		if (reset.resets != 0) {
+			if (hubs > 1) {
+				printf("Hub %u ", unit);
+			}
+			printf("Reset: %u resets, %u timed out", reset.resets, reset.timeouts);
+			if (reset.resets > reset.timeouts) {
+				printf(", ready after last %u us, min %u us, max %u us",
+				       reset.lastReady_us, reset.minReady_us, reset.maxReady_us);
+			}
+			printf(".\n");
+		}
+	}
+
+	bno_getIntnCaptureStats(&capture);
+	if (capture.mode != BNO_INTN_TS_EXTI) {
+		printf("INTN capture: %u missed, %u overcaptured.\n",
+		       capture.missed, capture.overcaptures);
+	}
+	if ((capture.mode == BNO_INTN_TS_COMPARE) && (capture.compared != 0)) {
+		printf("INTN EXTI latency: min %u us, mean %u us, max %u us, "
+		       "jitter %u us over %u edges.\n",
+		       capture.minLatency_us,
+		       (uint32_t)(capture.totalLatency_us / capture.compared),
+		       capture.maxLatency_us,
+		       capture.maxLatency_us - capture.minLatency_us,
+		       capture.compared);
+	}
+
+	bno_getI2cRecovery(&recovery);
+	if (recovery.retries + recovery.failed != 0) {
+		printf("I2C recovery: %u retries, %u recovered, %u failed, "
+		       "%u bus clears.  (i2c command for details.)\n",
+		       recovery.retries, recovery.recovered, recovery.failed,
+		       recovery.busClears);
+	}
+
+	bno_getWakeStats(&wakeI2c, &wakeIntn);
+	printWakeStats("I2C", &wakeI2c);
+	printWakeStats("INTN", &wakeIntn);
+
+	bno_getDeadlineStats(&deadlines);
+	if (deadlines.timeouts != 0) {
+		printf("INTN deadlines: %u waits, %u timed out, late mean %u us, max %u us.\n",
+		       deadlines.waits, deadlines.timeouts,
+		       (uint32_t)(deadlines.totalLate_us / deadlines.timeouts),
+		       deadlines.maxLate_us);
+	}
+
+	console_getStats(&stats);
+	printf("Console: %u bytes sent in %u DMA transfers.  "
+	       "Dropped records: stdio %u, sensor %u.\n",
+	       stats.txBytes, stats.txDmaTransfers,
+	       stats.dropRecords[CONSOLE_SRC_STDIO],
+	       stats.dropRecords[CONSOLE_SRC_SENSOR]);
+}
+
 // --- Private methods ----------------------------------------------
 
 void reportVersions(void)
 {
 	printf("\nSH-1 Demo App : Version %s\n", SENSOR_APP_VERSION);
 	printf("SH-1 Driver   : Version %s\n", SH1_DRIVER_VERSION);
+	printf("Timebase      : %u Hz\n", timebase_tickHz());
+	console_printBaudRates();
 	// TODO-DW
 }
 
@@ -129,10 +567,9 @@ void reportProdIds(void *pSensorHub)
 	}
 }
 
-void startReports(void *pSensorHub)
+void startReports(void)
 {
 	sh_SensorConfig_t config;
-	int status;
 
 	config.changeSensitivityEnabled = false;
 	config.wakeupEnabled = false;
@@ -141,197 +578,501 @@ void startReports(void *pSensorHub)
 	config.reportInterval_us = 10000; // microseconds (100Hz)
 	config.reserved1 = 0;
 
-	status = sh_setSensorConfig(pSensorHub, SH_ROTATION_VECTOR, &config);
-	if (status != SH_STATUS_SUCCESS) {
-		printf("Error while enabling RotationVector sensor: %d\n", status);
+	applyConfig(SH_ROTATION_VECTOR, &config);
+
+	// Additional reports can be enabled from the shell, e.g.
+	// "enable rawacc 10000".
+}
+
+// Configure a sensor the same way on every hub.
+void applyConfig(int sensor, const sh_SensorConfig_t *pConfig)
+{
+	bool ok = true;
+
+	for (unsigned unit = 0; unit < numHubs; unit++) {
+		if (configureHub(unit, sensor, pConfig) != SH_STATUS_SUCCESS) {
+			ok = false;
+		}
 	}
 
-    // Additional reports that can be enabled, if desired.
-#if 0  
-	status = sh_setSensorConfig(pSensorHub, SH_RAW_ACCELEROMETER, &config);
-	if (status != SH_STATUS_SUCCESS) {
-		printf("Error while enabling Raw Accelerometer sensor: %d\n", status);
+	if (ok) {
+		sensorConfig[sensor] = *pConfig;
 	}
-#endif
-#if 0
-	status = sh_setSensorConfig(pSensorHub, SH_RAW_MAGNETOMETER, &config);
+}
+
+int configureHub(unsigned unit, int sensor, const sh_SensorConfig_t *pConfig)
+{
+	int status = sh_setSensorConfig(sensorHub[unit], sensor, pConfig);
 	if (status != SH_STATUS_SUCCESS) {
-		printf("Error while enabling Magnetometer sensor: %d\n", status);
+		printf("Error while configuring sensor %d on hub %u: %d\n",
+		       sensor, unit, status);
+		return status;
 	}
-#endif
-#if 0
-	status = sh_setSensorConfig(pSensorHub, SH_RAW_GYROSCOPE, &config);
-	if (status != SH_STATUS_SUCCESS) {
-		printf("Error while enabling Gyroscope sensor: %d\n", status);
+
+	// Reports are due from one interval after now
+	liveness[unit].lastEvent[sensor] = xTaskGetTickCount();
+
+	return status;
+}
+
+// Apply the config of every running sensor to a hub again.
+void replayConfig(unsigned unit)
+{
+	for (int sensor = 0; sensor <= SH_MAX_SENSOR_ID; sensor++) {
+		if (sensorConfig[sensor].reportInterval_us != 0) {
+			configureHub(unit, sensor, &sensorConfig[sensor]);
+		}
+	}
+}
+
+// Reset a hub if an enabled sensor has stopped reporting.
+void checkLiveness(unsigned unit)
+{
+	liveness_t *pLive = &liveness[unit];
+	TickType_t now = xTaskGetTickCount();
+
+	for (int sensor = 0; sensor <= SH_MAX_SENSOR_ID; sensor++) {
+		const sh_SensorConfig_t *pConfig = &sensorConfig[sensor];
+		if ((pConfig->reportInterval_us == 0) ||
+		    pConfig->changeSensitivityEnabled) {
+			// Not expected to report on a schedule
+			continue;
+		}
+
+		uint32_t deadline_ms = pConfig->reportInterval_us / 1000 * LIVENESS_MISSED;
+		if (deadline_ms < LIVENESS_MIN_MS) {
+			deadline_ms = LIVENESS_MIN_MS;
+		}
+		if (timebase_ticksToMs(now - pLive->lastEvent[sensor], configTICK_RATE_HZ) > deadline_ms) {
+			resetHub(unit, sensor);
+			return;
+		}
+	}
+}
+
+// Reset a hub that stopped reporting sensor, and configure it again.
+void resetHub(unsigned unit, int sensor)
+{
+	liveness_t *pLive = &liveness[unit];
+
+	if (!pLive->down) {
+		// Outage runs from the last report until this sensor reports
+		// again, over as many resets as it takes.
+		pLive->down = true;
+		pLive->downSensor = sensor;
+		pLive->downSince = pLive->lastEvent[sensor];
+	}
+	pLive->resets++;
+
+	if (outputMode == SENSOR_APP_OUTPUT_TEXT) {
+		printf("Hub %u: sensor %d stopped reporting, resetting.\n", unit, sensor);
+	}
+
+	// Reinitializing resets the hub (shdev_reset) and the driver's state
+	sensorHub[unit] = sh_init(unit);
+	replayConfig(unit);
+}
+
+// Read the events a hub has pending and hand them to the output task.
+void serviceHub(unsigned unit)
+{
+	static sh_SensorEvent_t batch[EVENT_BATCH_LEN];
+	unsigned count = sensorApp_getEvents(unit, batch, EVENT_BATCH_LEN);
+
+	if (count > maxBatch) {
+		maxBatch = count;
+	}
+	for (unsigned n = 0; n < count; n++) {
+		queueEvent(unit, &batch[n]);
+	}
+}
+
+// Count an event, note it for liveness and queue it for output.
+void queueEvent(unsigned unit, const sh_SensorEvent_t *pEvent)
+{
+	hubStats_t *pHub = &hubStats[unit];
+	hubEvent_t item;
+
+	item.unit = unit;
+	item.event = *pEvent;
+	pHub->received++;
+	eventsReceived++;
+
+	// Liveness
+	liveness_t *pLive = &liveness[unit];
+	TickType_t now = xTaskGetTickCount();
+	if (item.event.sensor <= SH_MAX_SENSOR_ID) {
+		pLive->lastEvent[item.event.sensor] = now;
+	}
+	if (pLive->down && (item.event.sensor == pLive->downSensor)) {
+		uint32_t outage_ms = timebase_ticksToMs(now - pLive->downSince, configTICK_RATE_HZ);
+		pLive->down = false;
+		pLive->outages++;
+		pLive->lastOutage_ms = outage_ms;
+		pLive->totalOutage_ms += outage_ms;
+		if (outage_ms > pLive->maxOutage_ms) {
+			pLive->maxOutage_ms = outage_ms;
+		}
+	}
+
+	// Never block here: if output can't keep up, drop the event rather
+	// than stall the hubs.
+	if (xQueueSend(eventQueue, &item, 0) != pdPASS) {
+		pHub->dropped++;
+		eventsDropped++;
+	}
+	else {
+		unsigned depth = uxQueueMessagesWaiting(eventQueue);
+		if (depth > queueHighWater) {
+			queueHighWater = depth;
+		}
 	}
-#endif
-#if 0
-	status = sh_setSensorConfig(pSensorHub, SH_ACCELEROMETER, &config);
-        if (status != SH_STATUS_SUCCESS) {
-          printf("Error while enabling Accelerometer sensor: %d\n", status);
-        }
-#endif
-#if 0
-	status = sh_setSensorConfig(pSensorHub, SH_MAGNETIC_FIELD_CALIBRATED, &config);
-        if (status != SH_STATUS_SUCCESS) {
-          printf("Error while enabling Magnetic Field sensor: %d\n", status);
-        }
-#endif
 }
 
+// DSF column headers for each sensor the printers know about
+static const struct {
+	int sensor;
+	const char *columns;
+} dsfHeaders[] = {
+	{ SH_ROTATION_VECTOR,
+	  "TIME[x]{s}, SAMPLE_ID[x]{samples}, ANG_POS_GLOBAL[rijk]{quaternion}, ANG_POS_ACCURACY[x]{rad}" },
+	{ SH_RAW_ACCELEROMETER,
+	  "TIME[x]{s}, SAMPLE_ID[x]{samples}, RAW_ACCELEROMETER[xyz]{adc units}" },
+	{ SH_RAW_MAGNETOMETER,
+	  "TIME[x]{s}, SAMPLE_ID[x]{samples}, RAW_MAGNETOMETER[xyz]{adc units}" },
+	{ SH_RAW_GYROSCOPE,
+	  "TIME[x]{s}, SAMPLE_ID[x]{samples}, RAW_GYROSCOPE[xyz]{adc units}" },
+	{ SH_ACCELEROMETER,
+	  "TIME[x]{s}, SAMPLE_ID[x]{samples}, ACCELEROMETER[xyz]{m/s^2}" },
+	{ SH_MAGNETIC_FIELD_CALIBRATED,
+	  "TIME[x]{s}, SAMPLE_ID[x]{samples}, MAG_FIELD[xyz]{uTesla}, STATUS[x]{enum}" },
+};
+
+// Headers for each hub's channels (see BINSTREAM_UNIT_CHANNELS)
 void printDsfHeaders(void)
 {
-	printf("+%d TIME[x]{s}, SAMPLE_ID[x]{samples}, ANG_POS_GLOBAL[rijk]{quaternion}, ANG_POS_ACCURACY[x]{rad}\n",
-		SH_ROTATION_VECTOR);
-	printf("+%d TIME[x]{s}, SAMPLE_ID[x]{samples}, RAW_ACCELEROMETER[xyz]{adc units}\n",
-		SH_RAW_ACCELEROMETER);
-	printf("+%d TIME[x]{s}, SAMPLE_ID[x]{samples}, RAW_MAGNETOMETER[xyz]{adc units}\n",
-		SH_RAW_MAGNETOMETER);
-	printf("+%d TIME[x]{s}, SAMPLE_ID[x]{samples}, RAW_GYROSCOPE[xyz]{adc units}\n",
-		SH_RAW_GYROSCOPE);
-	printf("+%d TIME[x]{s}, SAMPLE_ID[x]{samples}, ACCELEROMETER[xyz]{m/s^2}\n",
-		SH_ACCELEROMETER);
-	printf("+%d TIME[x]{s}, SAMPLE_ID[x]{samples}, MAG_FIELD[xyz]{uTesla}, STATUS[x]{enum}\n",
-		SH_MAGNETIC_FIELD_CALIBRATED);
+	for (unsigned unit = 0; unit < numHubs; unit++) {
+		for (unsigned n = 0; n < sizeof(dsfHeaders)/sizeof(dsfHeaders[0]); n++) {
+			printf("+%u %s\n",
+			       unit * BINSTREAM_UNIT_CHANNELS + dsfHeaders[n].sensor,
+			       dsfHeaders[n].columns);
+		}
+	}
 }
 
-void printDsf(const sh_SensorEvent_t * event)
+void printDsf(unsigned unit, const sh_SensorEvent_t * event)
 {
-	float t, r, i, j, k, acc_rad;
-	static uint32_t lastSequence[SH_MAX_SENSOR_ID+1];  // last sequence number for each sensor
+	char line[128];
+	char *p = line;
+	static uint32_t lastSequence[MAX_SH_UNITS][SH_MAX_SENSOR_ID+1];  // last sequence number for each sensor
+	uint32_t *pLast = &lastSequence[unit][event->sensor];
 
 	// Compute new sample_id
-	uint8_t deltaSeq = event->sequenceNumber - (lastSequence[event->sensor] & 0xFF);
-	lastSequence[event->sensor] += deltaSeq;
+	uint8_t deltaSeq = event->sequenceNumber - (*pLast & 0xFF);
+	*pLast += deltaSeq;
 
-	// Get time as float
-	t = event->time_us / 1000000.0;
+	// Common prefix: channel, time, sample_id
+	*p++ = '.';
+	p = fixfmt_int(p, unit * BINSTREAM_UNIT_CHANNELS + event->sensor);
+	p = fixfmt_str(p, " ");
+	p = fixfmt_time_us(p, timebase_extend(event->time_us));
+	p = fixfmt_str(p, ", ");
+	p = fixfmt_int(p, *pLast);
 	
 	switch (event->sensor) {
 	case SH_RAW_ACCELEROMETER:
-		printf(".%d %0.6f, %d, %d, %d, %d\n",
-		       SH_RAW_ACCELEROMETER,
-		       t,
-		       lastSequence[event->sensor],
-		       event->un.rawAccelerometer.x,
-		       event->un.rawAccelerometer.y,
-		       event->un.rawAccelerometer.z);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_int(p, event->un.rawAccelerometer.x);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_int(p, event->un.rawAccelerometer.y);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_int(p, event->un.rawAccelerometer.z);
 		break;
 		
 	case SH_RAW_MAGNETOMETER:
-		printf(".%d %0.6f, %d, %d, %d, %d\n",
-		       SH_RAW_MAGNETOMETER,
-		       t,
-		       lastSequence[event->sensor],
-		       event->un.rawMagnetometer.x,
-		       event->un.rawMagnetometer.y,
-		       event->un.rawMagnetometer.z);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_int(p, event->un.rawMagnetometer.x);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_int(p, event->un.rawMagnetometer.y);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_int(p, event->un.rawMagnetometer.z);
 		break;
 		
 	case SH_RAW_GYROSCOPE:
-		printf(".%d %0.6f, %d, %d, %d, %d\n",
-		       SH_RAW_GYROSCOPE,
-		       t,
-		       lastSequence[event->sensor],
-		       event->un.rawGyroscope.x,
-		       event->un.rawGyroscope.y,
-		       event->un.rawGyroscope.z);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_int(p, event->un.rawGyroscope.x);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_int(p, event->un.rawGyroscope.y);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_int(p, event->un.rawGyroscope.z);
 		break;
 
 	case SH_MAGNETIC_FIELD_CALIBRATED:
-		printf(".%d %0.6f, %d, %0.3f, %0.3f, %0.3f, %u\n",
-		       SH_MAGNETIC_FIELD_CALIBRATED,
-		       t,
-		       lastSequence[event->sensor],
-		       FROM_16Q4(event->un.magneticField.x_16Q4),
-		       FROM_16Q4(event->un.magneticField.y_16Q4),
-		       FROM_16Q4(event->un.magneticField.z_16Q4),
-		       event->status & 0x3
-			);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_q(p, event->un.magneticField.x_16Q4, 4, 3);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_q(p, event->un.magneticField.y_16Q4, 4, 3);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_q(p, event->un.magneticField.z_16Q4, 4, 3);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_uint(p, event->status & 0x3);
 		break;
 		
 	case SH_ACCELEROMETER:
-		printf(".%d %0.6f, %d, %0.3f, %0.3f, %0.3f\n",
-		       SH_ACCELEROMETER,
-		       t,
-		       lastSequence[event->sensor],
-		       FROM_16Q8(event->un.accelerometer.x_16Q8),
-		       FROM_16Q8(event->un.accelerometer.y_16Q8),
-		       FROM_16Q8(event->un.accelerometer.z_16Q8));
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_q(p, event->un.accelerometer.x_16Q8, 8, 3);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_q(p, event->un.accelerometer.y_16Q8, 8, 3);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_q(p, event->un.accelerometer.z_16Q8, 8, 3);
 		break;
 		
 	case SH_ROTATION_VECTOR:
-		r = FROM_16Q14(event->un.rotationVector.real_16Q14);
-		i = FROM_16Q14(event->un.rotationVector.i_16Q14);
-		j = FROM_16Q14(event->un.rotationVector.j_16Q14);
-		k = FROM_16Q14(event->un.rotationVector.k_16Q14);
-		acc_rad = FROM_16Q12(event->un.rotationVector.accuracy_16Q12);
-		printf(".%d %0.6f, %d, %0.3f, %0.3f, %0.3f, %0.3f, %0.3f\n",
-		       SH_ROTATION_VECTOR,
-		       t,
-		       lastSequence[event->sensor],
-		       r, i, j, k,
-		       acc_rad);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_q(p, event->un.rotationVector.real_16Q14, 14, 3);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_q(p, event->un.rotationVector.i_16Q14, 14, 3);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_q(p, event->un.rotationVector.j_16Q14, 14, 3);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_q(p, event->un.rotationVector.k_16Q14, 14, 3);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_q(p, event->un.rotationVector.accuracy_16Q12, 12, 3);
 		break;
 	default:
 		printf("Unknown sensor: %d\n", event->sensor);
-		break;
+		return;
 	}
+
+	p = fixfmt_str(p, "\n");
+	console_writeRecord(line, p - line, CONSOLE_SRC_SENSOR, CONSOLE_PRIO_BULK);
 }
 
-void printEvent(const sh_SensorEvent_t * event)
+void printEvent(unsigned unit, const sh_SensorEvent_t * event)
 {
-	float scaleRadToDeg = 180.0 / 3.14159265358;
-	float t, r, i, j, k, acc_deg;
+	char line[128];
+	char *p = line;
+
+	if (numHubs > 1) {
+		p = fixfmt_str(p, "[");
+		p = fixfmt_uint(p, unit);
+		p = fixfmt_str(p, "] ");
+	}
     
 	switch (event->sensor) {
 	case SH_RAW_ACCELEROMETER:
-		printf("Raw acc: %d %d %d\n",
-		       event->un.rawAccelerometer.x,
-		       event->un.rawAccelerometer.y, event->un.rawAccelerometer.z);
+		p = fixfmt_str(p, "Raw acc: ");
+		p = fixfmt_int(p, event->un.rawAccelerometer.x);
+		p = fixfmt_str(p, " ");
+		p = fixfmt_int(p, event->un.rawAccelerometer.y);
+		p = fixfmt_str(p, " ");
+		p = fixfmt_int(p, event->un.rawAccelerometer.z);
 		break;
 		
 	case SH_RAW_MAGNETOMETER:
-		printf("Raw mag: %d %d %d\n",
-		       event->un.rawMagnetometer.x,
-		       event->un.rawMagnetometer.y, event->un.rawMagnetometer.z);
+		p = fixfmt_str(p, "Raw mag: ");
+		p = fixfmt_int(p, event->un.rawMagnetometer.x);
+		p = fixfmt_str(p, " ");
+		p = fixfmt_int(p, event->un.rawMagnetometer.y);
+		p = fixfmt_str(p, " ");
+		p = fixfmt_int(p, event->un.rawMagnetometer.z);
 		break;
 		
 	case SH_RAW_GYROSCOPE:
-		printf("Raw gyro: %d %d %d\n",
-		       event->un.rawGyroscope.x,
-		       event->un.rawGyroscope.y, event->un.rawGyroscope.z);
+		p = fixfmt_str(p, "Raw gyro: ");
+		p = fixfmt_int(p, event->un.rawGyroscope.x);
+		p = fixfmt_str(p, " ");
+		p = fixfmt_int(p, event->un.rawGyroscope.y);
+		p = fixfmt_str(p, " ");
+		p = fixfmt_int(p, event->un.rawGyroscope.z);
 		break;
 
 	case SH_ACCELEROMETER:
-		printf("Acc: x:%0.3f y:%0.3f z:%03.f\n",
-		       FROM_16Q8(event->un.accelerometer.x_16Q8),
-		       FROM_16Q8(event->un.accelerometer.y_16Q8),
-		       FROM_16Q8(event->un.accelerometer.z_16Q8));
+		p = fixfmt_str(p, "Acc: x:");
+		p = fixfmt_q(p, event->un.accelerometer.x_16Q8, 8, 3);
+		p = fixfmt_str(p, " y:");
+		p = fixfmt_q(p, event->un.accelerometer.y_16Q8, 8, 3);
+		p = fixfmt_str(p, " z:");
+		p = fixfmt_q(p, event->un.accelerometer.z_16Q8, 8, 3);
 		break;
 	case SH_MAGNETIC_FIELD_CALIBRATED:
-		printf("Mag: %0.3f, %0.3f, %0.3f, Status: %u\n",
-		       FROM_16Q4(event->un.magneticField.x_16Q4),
-		       FROM_16Q4(event->un.magneticField.y_16Q4),
-		       FROM_16Q4(event->un.magneticField.z_16Q4),
-		       event->status & 0x3);
+		p = fixfmt_str(p, "Mag: ");
+		p = fixfmt_q(p, event->un.magneticField.x_16Q4, 4, 3);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_q(p, event->un.magneticField.y_16Q4, 4, 3);
+		p = fixfmt_str(p, ", ");
+		p = fixfmt_q(p, event->un.magneticField.z_16Q4, 4, 3);
+		p = fixfmt_str(p, ", Status: ");
+		p = fixfmt_uint(p, event->status & 0x3);
 		break;
 	case SH_ROTATION_VECTOR:
-		t = event->time_us / 1000000.0;
-		r = FROM_16Q14(event->un.rotationVector.real_16Q14);
-		i = FROM_16Q14(event->un.rotationVector.i_16Q14);
-		j = FROM_16Q14(event->un.rotationVector.j_16Q14);
-		k = FROM_16Q14(event->un.rotationVector.k_16Q14);
-		acc_deg = scaleRadToDeg *
-			FROM_16Q12(event->un.rotationVector.accuracy_16Q12);
-		printf("Rotation Vector: "
-		       "t:%0.6f r:%0.3f i:%0.3f j:%0.3f k:%0.3f (acc: %0.3f [deg])\n", 
-		       t, r, i, j, k, acc_deg);
+		p = fixfmt_str(p, "Rotation Vector: t:");
+		p = fixfmt_time_us(p, timebase_extend(event->time_us));
+		p = fixfmt_str(p, " r:");
+		p = fixfmt_q(p, event->un.rotationVector.real_16Q14, 14, 3);
+		p = fixfmt_str(p, " i:");
+		p = fixfmt_q(p, event->un.rotationVector.i_16Q14, 14, 3);
+		p = fixfmt_str(p, " j:");
+		p = fixfmt_q(p, event->un.rotationVector.j_16Q14, 14, 3);
+		p = fixfmt_str(p, " k:");
+		p = fixfmt_q(p, event->un.rotationVector.k_16Q14, 14, 3);
+		p = fixfmt_str(p, " (acc: ");
+		// accuracy (Q12 radians) times 180/pi (float, Q18)
+		p = fixfmt_qFloat(p, (int64_t)event->un.rotationVector.accuracy_16Q12 *
+		                  FIXFMT_RAD_TO_DEG_MANT,
+		                  12 + FIXFMT_RAD_TO_DEG_Q, 3);
+		p = fixfmt_str(p, " [deg])");
 		break;
 	default:
 		printf("Unknown sensor: %d\n", event->sensor);
+		return;
+	}
+
+	p = fixfmt_str(p, "\n");
+	console_writeRecord(line, p - line, CONSOLE_SRC_SENSOR, CONSOLE_PRIO_BULK);
+}
+
+void printBinaryHeaders(void)
+{
+	char line[128];
+	uint8_t frame[BINSTREAM_FRAME_MAX(1 + sizeof(line))];
+	
+	// Send the DSF headers as text frames so the decoder needs no
+	// knowledge of sensor ids.
+	for (unsigned unit = 0; unit < numHubs; unit++) {
+		for (unsigned n = 0; n < sizeof(dsfHeaders)/sizeof(dsfHeaders[0]); n++) {
+			int len = snprintf(line, sizeof(line), "+%u %s",
+			                   unit * BINSTREAM_UNIT_CHANNELS + dsfHeaders[n].sensor,
+			                   dsfHeaders[n].columns);
+			if (len >= (int)sizeof(line)) {
+				len = sizeof(line) - 1;
+			}
+			len = binstream_frame(frame, BINSTREAM_TYPE_HEADER,
+			                      (const uint8_t *)line, len);
+			console_writeFrame(frame, len, CONSOLE_SRC_STDIO, CONSOLE_PRIO_HIGH);
+		}
+	}
+}
+
+void printBinary(unsigned unit, const sh_SensorEvent_t * event)
+{
+	binstream_event_t rec;
+	uint8_t frame[BINSTREAM_FRAME_MAX(BINSTREAM_EVENT_LEN)];
+	size_t len;
+
+	rec.unit = unit;
+	rec.sensor = event->sensor;
+	rec.sequence = event->sequenceNumber;
+	rec.status = event->status;
+	rec.time_us = event->time_us;
+	rec.qPoint = 0;
+	rec.qPointLast = 0;
+	for (int n = 0; n < BINSTREAM_NUM_VALUES; n++) {
+		rec.v[n] = 0;
+	}
+
+	switch (event->sensor) {
+	case SH_RAW_ACCELEROMETER:
+		rec.format = BINSTREAM_FMT_RAW3;
+		rec.v[0] = event->un.rawAccelerometer.x;
+		rec.v[1] = event->un.rawAccelerometer.y;
+		rec.v[2] = event->un.rawAccelerometer.z;
+		break;
+	case SH_RAW_MAGNETOMETER:
+		rec.format = BINSTREAM_FMT_RAW3;
+		rec.v[0] = event->un.rawMagnetometer.x;
+		rec.v[1] = event->un.rawMagnetometer.y;
+		rec.v[2] = event->un.rawMagnetometer.z;
+		break;
+	case SH_RAW_GYROSCOPE:
+		rec.format = BINSTREAM_FMT_RAW3;
+		rec.v[0] = event->un.rawGyroscope.x;
+		rec.v[1] = event->un.rawGyroscope.y;
+		rec.v[2] = event->un.rawGyroscope.z;
+		break;
+	case SH_MAGNETIC_FIELD_CALIBRATED:
+		rec.format = BINSTREAM_FMT_Q3_STATUS;
+		rec.qPoint = 4;
+		rec.v[0] = event->un.magneticField.x_16Q4;
+		rec.v[1] = event->un.magneticField.y_16Q4;
+		rec.v[2] = event->un.magneticField.z_16Q4;
+		break;
+	case SH_ACCELEROMETER:
+		rec.format = BINSTREAM_FMT_Q3;
+		rec.qPoint = 8;
+		rec.v[0] = event->un.accelerometer.x_16Q8;
+		rec.v[1] = event->un.accelerometer.y_16Q8;
+		rec.v[2] = event->un.accelerometer.z_16Q8;
 		break;
+	case SH_ROTATION_VECTOR:
+		rec.format = BINSTREAM_FMT_QUAT;
+		rec.qPoint = 14;
+		rec.qPointLast = 12;
+		rec.v[0] = event->un.rotationVector.real_16Q14;
+		rec.v[1] = event->un.rotationVector.i_16Q14;
+		rec.v[2] = event->un.rotationVector.j_16Q14;
+		rec.v[3] = event->un.rotationVector.k_16Q14;
+		rec.v[4] = event->un.rotationVector.accuracy_16Q12;
+		break;
+	default:
+		// Not representable, skip it.
+		return;
+	}
+
+	len = binstream_encodeEvent(frame, &rec);
+	console_writeFrame(frame, len, CONSOLE_SRC_SENSOR, CONSOLE_PRIO_BULK);
+}
+
+void printWakeStats(const char *name, const bno_wakeStats_t *pStats)
+{
+	if (pStats->wakeups == 0) {
+		return;
 	}
+
+	printf("%s wake (%s): min %u us, mean %u us, max %u us over %u.\n",
+	       name, pStats->semaphore ? "semaphore" : "notification",
+	       pStats->minLatency_us,
+	       (uint32_t)(pStats->totalLatency_us / pStats->wakeups),
+	       pStats->maxLatency_us, pStats->wakeups);
 }
 
+#ifdef CONSOLE_BENCHMARK
+// Measure CPU cycles spent queuing typical printEvent lines, one byte per
+// call (the way __write used to feed putchar) versus one block per line.
+// Each pass fits in half the tx ring and starts with it empty, so neither
+// waits for the UART.
+void benchmarkConsole(void)
+{
+	static const char * const lines[] = {
+		"Rotation Vector: t:12.345678 r:0.188 i:0.000 j:0.008 k:-0.982 (acc: 22.703 [deg])\n",
+		"Raw acc: -1234 567 8901\n",
+		"Mag: 12.345, -6.789, 40.125, Status: 3\n",
+	};
+	uint32_t start, perByte, block;
+
+	for (unsigned n = 0; n < sizeof(lines)/sizeof(lines[0]); n++) {
+		size_t len = strlen(lines[n]);
+		// One more byte per line for the CR
+		unsigned reps = (CONSOLE_TXBUFLEN/2) / (len + 1);
 
+		console_flush();
+		start = prof_begin();
+		for (unsigned rep = 0; rep < reps; rep++) {
+			for (size_t i = 0; i < len; i++) {
+				console_write(&lines[n][i], 1);
+			}
+		}
+		perByte = prof_begin() - start;
+
+		console_flush();
+		start = prof_begin();
+		for (unsigned rep = 0; rep < reps; rep++) {
+			console_write(lines[n], len);
+		}
+		block = prof_begin() - start;
+
+		printf("Console benchmark, %u byte line x %u: per-byte %u cycles, block %u cycles\n",
+		       (unsigned)len, reps, perByte / reps, block / reps);
+	}
+}
+#endif
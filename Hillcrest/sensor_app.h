@@ -19,6 +19,45 @@
 #ifndef SENSOR_APP_H
 #define SENSOR_APP_H
 
+#include "SensorHub.h"
+
+// Output formats
+typedef enum {
+	SENSOR_APP_OUTPUT_TEXT = 0,   // human readable
+	SENSOR_APP_OUTPUT_DSF,        // DSF text for logging
+	SENSOR_APP_OUTPUT_BINARY,     // COBS framed binary records
+} sensorApp_output_t;
+
+// Create the event queue.  Call before starting the tasks.
+void sensorApp_init(void);
+
+// Service the sensorhub, queue its events.  (Never returns.)
 void sensorTask(void);
 
+// Format and transmit queued events.  (Never returns.)
+void outputTask(void);
+
+// Request a sensor config change.  (Applied by the sensor task after its
+// next event.)  A reportInterval_us of 0 disables the sensor.
+// Returns 0 if the request was queued.
+int sensorApp_setConfig(int sensor, const sh_SensorConfig_t *pConfig);
+
+// Read back the config last applied to a sensor.  Returns 0 on success.
+int sensorApp_getConfig(int sensor, sh_SensorConfig_t *pConfig);
+
+// Read the events a hub has pending, up to max, into pEvents.  Waits only
+// briefly after each for the hub to assert INTN again.  Call from the
+// sensor task.  Returns the number read.
+unsigned sensorApp_getEvents(unsigned unit, sh_SensorEvent_t *pEvents,
+                             unsigned max);
+
+// Select output format.  Headers for the new format precede its first event.
+void sensorApp_setOutput(sensorApp_output_t mode);
+
+// Output format selected.
+sensorApp_output_t sensorApp_getOutput(void);
+
+// Print event pipeline counters.
+void sensorApp_printStats(void);
+
 #endif
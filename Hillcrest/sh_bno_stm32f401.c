@@ -30,6 +30,10 @@
 #include "task.h"
 #include "semphr.h"
 
+#include "intn_fifo.h"
+#include "timebase.h"
+#include "rtos_pool.h"
+#include "prof.h"
 #include "dbg.h"
 
 // I2C addresses
@@ -41,8 +45,76 @@
 // How long to wait for INTN to get to a desired state (ms)
 #define MAX_WAIT_FOR_DATA (200)
 
+// Shortest RSTN low pulse (us).  After it the hub is ready when it asserts
+// INTN, and the bootloader when it acknowledges its address, or after
+// MAX_WAIT_FOR_DATA if neither happens.
+#ifndef RESET_PULSE_US
+#define RESET_PULSE_US (100)
+#endif
+
+// Hubs fitted.  Unit 1 answers at BNO_I2C_1 on the same bus, with its own
+// INTN, BOOTN and RSTN (see the pin definitions below).
+#ifndef BNO_NUM_UNITS
+#define BNO_NUM_UNITS (1)
+#endif
+
+// Source of INTN timestamps, a bno_intnTimestamp_t.  Hardware capture
+// takes the EXTI dispatch and any masked or higher priority interrupts
+// out of the edge time.
+#ifndef INTN_TIMESTAMP
+#define INTN_TIMESTAMP BNO_INTN_TS_EXTI
+#endif
+
+// Edges logged in compare mode, waiting to be printed.  Power of two.
+#define INTN_LOG_LEN (32)
+
+// Define this to wake tasks from the I2C and INTN ISRs with binary
+// semaphores instead of task notifications, to compare resume latency.
+// #define WAKE_BY_SEMAPHORE
+
+// Read HID reports by DMA at startup.  (Switchable with bno_setI2cDma.)
+#define I2C_DMA_DEFAULT (true)
+
+// Shorter reads always use interrupts
+#define I2C_DMA_MIN_LEN (2)
+
+// Fault recovery: tries per transfer, and the pause before the second
+// (doubled for each one after)
+#define I2C_MAX_ATTEMPTS (4)
+#define I2C_BACKOFF_MS (1)
+
+// Longest a started transfer may take (ms), and the STOP before it (us).
+// DFU writes are the longest, under 2ms at 400kHz.
+#define I2C_XFER_TIMEOUT_MS (20)
+#define I2C_IDLE_TIMEOUT_US (100)
+
+// Bus clear: SCL pulses to free a slave stuck mid-byte, and their half
+// period (us)
+#define I2C_CLEAR_PULSES (9)
+#define I2C_CLEAR_HALF_US (5)
+
+// Task notification bits: I2C completion, INTN of each unit, INTN of any
+// unit, then the TIM2 CH4 deadline
+#define WAKE_BIT_I2C       (0)
+#define WAKE_BIT_INTN(u)   (1 + (u))
+#define WAKE_BIT_INTN_ANY  (1 + MAX_SH_UNITS)
+#define WAKE_BIT_DEADLINE  (2 + MAX_SH_UNITS)
+#define WAKE_NUM_BITS      (3 + MAX_SH_UNITS)
+
 // --- Type Definitions ---------------------------------------------------
 
+// ISR to task wakeup.  The ISR sets a notification bit on the task that
+// armed it (or gives a semaphore, with WAKE_BY_SEMAPHORE).  Only one task
+// at a time may wait on each.
+typedef struct wake_s {
+	uint32_t bit;
+	TaskHandle_t task;            // task to notify
+	SemaphoreHandle_t sem;        // WAKE_BY_SEMAPHORE only
+	bool pending;                 // bit received during another wait
+	volatile uint32_t signal_us;  // when the ISR last signalled
+	bno_wakeStats_t stats;
+} wake_t;
+
 typedef struct bno_s {
   
 	// GPIO Support
@@ -50,12 +122,15 @@ typedef struct bno_s {
 	void (*setRstN)(bool state);
 	bool (*getIntN)(void);
         
+	// EXTI line of INTN
+	uint16_t intnPin;
+
 	// I2C information
 	uint16_t unit;
 	uint16_t dfuMode;
 	
-    // Semaphore to notify of changes on intn
-	SemaphoreHandle_t intnSem;
+	// Wakes the task waiting for changes on intn
+	wake_t intnWake;
 
 	// INTN status.  This boolean represents a sanitized version of the INTN
 	// signal of the BNO070.  It is deasserted (true) after reset and asserted
@@ -65,6 +140,16 @@ typedef struct bno_s {
 	// that signal can lead to double-reads.)
 	volatile bool intnStatus;
 
+	// INTN edges captured by the EXTI ISR, waiting for their reads
+	intnFifo_t intnFifo;
+	uint32_t intnSequence;
+
+	// Edge matched to the most recent read
+	intnEdge_t readEdge;
+
+	// Time from each reset to the hub or bootloader being ready
+	bno_resetStats_t resetStats;
+
 } bno_t;
 
 // --- Forward Declarations ------------------------------------------------
@@ -72,6 +157,39 @@ typedef struct bno_s {
 static void setBootN_0(bool state);
 static void setRstN_0(bool state);
 static bool getIntN_0(void);
+static void setBootN_1(bool state);
+static void setRstN_1(bool state);
+static bool getIntN_1(void);
+static void initUnit1(void);
+static uint32_t intnMask(void);
+static void intnAsserted(bno_t *pDev, uint32_t timestamp_us);
+static uint32_t compareCapture(uint32_t software_us);
+static void initCapture(void);
+static int i2cTransfer(uint16_t i2cAddr,
+                       const uint8_t *pSend, unsigned sendLen,
+                       uint8_t *pReceive, unsigned receiveLen,
+                       bno_i2cFault_t *pFault);
+static int i2cFinish(int rc, bno_i2cFault_t *pFault);
+static bool i2cIdle(void);
+static void i2cRecover(bno_i2cFault_t fault);
+static void i2cBusClear(void);
+static void spinUs(uint32_t wait_us);
+static void resetPulse(bno_t *pDev);
+static bool waitBootloaderReady(bno_t *pDev);
+static void resetDone(bno_t *pDev, bool ready, uint32_t release_us);
+static void i2cRecovered(uint32_t firstFault_us);
+static void wakeInit(wake_t *pWake, unsigned bit);
+static void wakeArm(wake_t *pWake);
+static void wakeFromISR(wake_t *pWake, BaseType_t *pWoken);
+static bool wakeWait(wake_t *pWake, TickType_t ticks);
+static bool wakeWaitUntil(wake_t *pWake, uint32_t deadline_us);
+static void wakeLatency(wake_t *pWake, bool woken, uint32_t start_us);
+static void deadlineStart(uint32_t deadline_us);
+static void deadlineStop(void);
+static void deadlineDone(bool woken, uint32_t deadline_us);
+static void wakeCancel(wake_t *pWake);
+static void wakeRepost(wake_t *pWake);
+static void wakeDispatch(uint32_t bits);
 
 // --- Private Data --------------------------------------------------------
 
@@ -82,29 +200,82 @@ bno_t bno_dev[MAX_SH_UNITS] = {
 		.setBootN = setBootN_0,
 		.setRstN = setRstN_0,
 		.getIntN = getIntN_0,
+		.intnPin = GPIO_PIN_10,
 		.unit = 0,
 	},
+	{
+		// Unit 1
+		.setBootN = setBootN_1,
+		.setRstN = setRstN_1,
+		.getIntN = getIntN_1,
+		.intnPin = GPIO_PIN_8,
+		.unit = 1,
+	},
 };
 
 // Handle of I2C peripheral
 I2C_HandleTypeDef *hi2c;
 
-// Handle of TIM peripheral for us timestamps
+// Handle of TIM peripheral for us timestamps (see timebase.c)
 TIM_HandleTypeDef *htim;
 
-volatile uint32_t intn0_timestamp = 0;
-volatile uint32_t intn0_sequence = 0;
+// Capture and compare counters, written by ISRs only
+bno_intnCaptureStats_t intnCapture = {
+	.mode = INTN_TIMESTAMP,
+	.minLatency_us = UINT32_MAX,
+};
+
+// Compare log.  The EXTI ISR fills at intnLogHead, the shell empties from
+// intnLogTail.  Indices run freely.
+bno_intnCompare_t intnLog[INTN_LOG_LEN];
+volatile uint32_t intnLogHead = 0;
+volatile uint32_t intnLogTail = 0;
 
 bool shdev_first_init_done = false;
 
-// Semaphore so i2c ISR can unblock task
-SemaphoreHandle_t bno_i2cOperationDone;
+// So i2c ISR can unblock task
+wake_t bno_i2cOperationDone;
+
+// So INTN ISRs can unblock a task serving several units
+wake_t bno_intnAny;
+
+// So TIM2 CH4 can end a wait between ticks.  One wait at a time.
+wake_t bno_deadline;
+
+// Waits with deadlines, updated by the waiting task
+bno_deadlineStats_t deadlineStats;
+
+// Wakeups by notification bit
+wake_t *wakeByBit[WAKE_NUM_BITS];
 
 // Mutex to sort out i2c bus operations
 SemaphoreHandle_t bno_i2cMutex;
 
+// The i2c mutex, and a semaphore per wake object with WAKE_BY_SEMAPHORE
+#ifdef WAKE_BY_SEMAPHORE
+RTOS_POOL(bnoPool, "sh_bno", RTOS_MUTEX_BYTES + WAKE_NUM_BITS * RTOS_SEMAPHORE_BYTES);
+#else
+RTOS_POOL(bnoPool, "sh_bno", RTOS_MUTEX_BYTES);
+#endif
+
 uint32_t bno_i2cErrors = 0;
 int bno_i2cStatus = 0;
+volatile uint32_t bno_i2cErrorCode = 0;
+
+// Faults and recovery, updated under the i2c mutex
+bno_i2cRecovery_t i2cRecovery = {
+	.minRecover_us = UINT32_MAX,
+};
+
+// Reads use DMA rather than an interrupt per byte
+volatile bool bno_i2cDma = I2C_DMA_DEFAULT;
+
+// I2C and I2C DMA interrupt entries, and CPU cycles spent in them
+volatile uint32_t bno_i2cIsrs = 0;
+volatile uint32_t bno_i2cIsrCycles = 0;
+
+// Cost of reads, by interrupt [0] and by DMA [1]
+bno_i2cCost_t i2cCost[2];
 
 
 
@@ -116,16 +287,22 @@ void * shdev_init(int unit)
 		shdev_first_init_done = true;
 
 		// Create i2c mutex and semaphore
-		bno_i2cOperationDone = xSemaphoreCreateBinary();
+		rtosPool_begin(&bnoPool);
+		wakeInit(&bno_i2cOperationDone, WAKE_BIT_I2C);
+		wakeInit(&bno_intnAny, WAKE_BIT_INTN_ANY);
+		wakeInit(&bno_deadline, WAKE_BIT_DEADLINE);
 		bno_i2cMutex = xSemaphoreCreateMutex();
 
 		for (int n = 0; n < MAX_SH_UNITS; n++) {
-			bno_dev[n].intnSem = xSemaphoreCreateBinary();
+			wakeInit(&bno_dev[n].intnWake, WAKE_BIT_INTN(n));
+			intnFifo_init(&bno_dev[n].intnFifo);
+			bno_dev[n].resetStats.minReady_us = UINT32_MAX;
 		}
+		rtosPool_end();
 	}
 	
 	// Validate unit
-	if ((unit < 0) || (unit >= MAX_SH_UNITS)) {
+	if ((unit < 0) || (unit >= BNO_NUM_UNITS)) {
 		// no such unit
 		return 0;
 	}
@@ -134,6 +311,9 @@ void * shdev_init(int unit)
 
 	pDev->dfuMode = false;
 
+	// INTN edges wake the task driving this unit
+	wakeArm(&pDev->intnWake);
+
 	// INTN deasserted
 	pDev->intnStatus = true;
         
@@ -146,21 +326,23 @@ sh_Status_t shdev_reset(void * dev)
         
         pDev->dfuMode = false;
     
-	// Assert reset
-	pDev->setRstN(false);
-    
 	// Boot into sensorhub, not bootloader
+	resetPulse(pDev);
 	pDev->setBootN(true);
     
-	// INTN deasserted
-	pDev->intnStatus = true;
-        
-	// Wait 10ms
-	vTaskDelay(10); 
-    
 	// Take BNO out of reset
+	uint32_t release_us = timebase_now32();
 	pDev->setRstN(true);
 
+	// The hub asserts INTN once it has booted and has its first report
+	uint32_t deadline_us = timebase_now32() + MAX_WAIT_FOR_DATA * 1000;
+	bool ready = (bno_waitIntnUntil(pDev->unit, deadline_us) == BNO_WAIT_EDGE);
+	if (ready) {
+		// Leave the edge for the driver's own wait on INTN
+		wakeRepost(&pDev->intnWake);
+	}
+	resetDone(pDev, ready, release_us);
+
 	return SH_STATUS_SUCCESS;
 }
     
@@ -170,23 +352,15 @@ sh_Status_t shdev_reset_dfu(void * dev)
     
         pDev->dfuMode = true;
         
-	// Assert reset
-	pDev->setRstN(false);
-    
-	// Boot into bootlaoder, not sensorhub application
+	// Boot into bootloader, not sensorhub application
+	resetPulse(pDev);
 	pDev->setBootN(false);
     
-	// INTN deasserted
-	pDev->intnStatus = true;
-        
-	// Wait 10ms
-	vTaskDelay(10); 
-    
 	// Take BNO out of reset
+	uint32_t release_us = timebase_now32();
 	pDev->setRstN(true);
 
-	// Wait until bootloader is ready.
-	vTaskDelay(200); 
+	resetDone(pDev, waitBootloaderReady(pDev), release_us);
     
 	return SH_STATUS_SUCCESS;
 }
@@ -198,11 +372,16 @@ sh_Status_t shdev_i2c(void *pDev,
 	int rc;
 	bno_t * pBno = (bno_t *)pDev;
 	uint16_t i2cAddr = 0;
+	bno_i2cFault_t fault;
+	uint32_t firstFault_us = 0;
+	// At least a tick, so a slow tick rate still backs off
+	TickType_t backoff = timebase_ticksFor(I2C_BACKOFF_MS * 1000, configTICK_RATE_HZ);
         
 	if ((sendLen == 0) && (receiveLen == 0)) {
 		// Nothing to send, skip the whole thing
 		return SH_STATUS_SUCCESS;
 	}
+	uint32_t start = prof_begin();
 	
 	/* Determine which I2C address to use, based on unit and DFU mode */
 	if (pBno->unit == 0) {
@@ -224,57 +403,50 @@ sh_Status_t shdev_i2c(void *pDev,
   
 	// Acquire i2c mutex
 	xSemaphoreTake(bno_i2cMutex, portMAX_DELAY);
-	bno_i2cStatus = SH_STATUS_SUCCESS;
-	
-	if ((sendLen != 0) && (receiveLen != 0)) {
-		// Perform write, then read with repeated start
-		// Acquire i2c mutex
-		rc = HAL_I2C_Master_Sequential_Transmit_IT(hi2c, i2cAddr,
-		                                           (uint8_t *)pSend, sendLen,
-		                                           I2C_FIRST_FRAME);
-		
-		// Transfer portion started, wait until it finishes.
-		xSemaphoreTake(bno_i2cOperationDone, portMAX_DELAY);
-
-		// Finish with receive portion.
-		rc = HAL_I2C_Master_Sequential_Receive_IT(hi2c, i2cAddr,
-		                                          pReceive, receiveLen,
-			                                      I2C_LAST_FRAME);
-		if (rc == 0)
-		{
-			// INTN deasserted
-			pBno->intnStatus = true;
-		}
-        
-	}
-	else if (sendLen != 0) {
-		// Perform write only
-		rc = HAL_I2C_Master_Transmit_IT(hi2c, i2cAddr,
-		                             (uint8_t *)pSend, sendLen);
+
+	if (receiveLen != 0) {
+		// INTN deasserted, this read answers the oldest edge.  (The hub
+		// holds INTN low until the read, so no new edge can come first.)
+		pBno->intnStatus = true;
+		intnFifo_pop(&pBno->intnFifo, &pBno->readEdge);
 	}
-	else {
-		// Perform read only
-		rc = HAL_I2C_Master_Receive_IT(hi2c, i2cAddr,
-		                            pReceive, receiveLen);
-		if (rc == 0)
-		{
-			// INTN deasserted
-			pBno->intnStatus = true;
+
+	// Try a few times, recovering the bus after each fault
+	for (unsigned attempt = 1; ; attempt++) {
+		rc = i2cTransfer(i2cAddr, pSend, sendLen, pReceive, receiveLen, &fault);
+		if (rc == HAL_OK) {
+			if (attempt > 1) {
+				i2cRecovered(firstFault_us);
+			}
+			break;
 		}
-	}
 
-	if (rc == HAL_OK) {
-		// Operation started,
-		
-		// wait until operation finishes.
-		xSemaphoreTake(bno_i2cOperationDone, portMAX_DELAY);
+		i2cRecovery.faults[fault]++;
+		if (attempt == 1) {
+			firstFault_us = timebase_now32();
+		}
+		i2cRecover(fault);
+
+		if (attempt >= I2C_MAX_ATTEMPTS) {
+			i2cRecovery.failed++;
+			if (receiveLen != 0) {
+				// Report not read: the physical INTN says if it's still there
+				pBno->intnStatus = pBno->getIntN();
+			}
+			break;
+		}
 
-		// Use i2c operation status now for rc
-		rc = bno_i2cStatus;
+		// Back off, doubling each time.  Other hubs may use the bus meanwhile.
+		i2cRecovery.retries++;
+		xSemaphoreGive(bno_i2cMutex);
+		vTaskDelay(backoff);
+		xSemaphoreTake(bno_i2cMutex, portMAX_DELAY);
+		backoff *= 2;
 	}
 		
 	// Release i2c mutex
 	xSemaphoreGive(bno_i2cMutex);
+	prof_end(PROF_SHDEV_I2C, start);
 		
 	if (rc != HAL_OK) {
 		return SH_STATUS_ERROR_I2C_IO;
@@ -293,32 +465,208 @@ bool shdev_getIntn(void *dev)
 bool shdev_waitIntn(void *dev, uint16_t wait_ms)
 {
 	bno_t *pDev = (bno_t *)dev;
-	bool actual = pDev->intnStatus;
-
-	TickType_t semWait = (wait_ms == SH_WAIT_FOREVER) ? portMAX_DELAY : wait_ms * portTICK_PERIOD_MS;
 
-	xSemaphoreTake(pDev->intnSem, semWait);
-	actual = pDev->intnStatus;
+	wakeArm(&pDev->intnWake);
+	if (wait_ms == SH_WAIT_FOREVER) {
+		wakeWait(&pDev->intnWake, portMAX_DELAY);
+	}
+	else {
+		wakeWaitUntil(&pDev->intnWake, timebase_now32() + (uint32_t)wait_ms * 1000);
+	}
 
-	return actual;
+	return pDev->intnStatus;
 }
 
 uint32_t shdev_getTimestamp_us(void *dev)
 {
-	return intn0_timestamp;
+	bno_t *pDev = (bno_t *)dev;
+
+	// Time of the edge that announced the report just read.  (If a read
+	// had no edge to match, the previous edge's time is repeated.)
+	return pDev->readEdge.timestamp_us;
+}
+
+void bno_getIntnStats(int unit, intnFifo_stats_t *pStats)
+{
+	if ((unit < 0) || (unit >= MAX_SH_UNITS)) {
+		return;
+	}
+
+	intnFifo_getStats(&bno_dev[unit].intnFifo, pStats);
+}
+
+unsigned bno_numUnits(void)
+{
+	return BNO_NUM_UNITS;
+}
+
+uint32_t bno_waitIntnAny(uint32_t wait_ms)
+{
+	uint32_t deadline_us = timebase_now32() + wait_ms * 1000;
+
+	// An edge between the check and the wait leaves its bit set, so the
+	// wait returns at once.
+	wakeArm(&bno_intnAny);
+	uint32_t mask = intnMask();
+	if (mask == 0) {
+		if (wait_ms == SH_WAIT_FOREVER) {
+			wakeWait(&bno_intnAny, portMAX_DELAY);
+		}
+		else {
+			wakeWaitUntil(&bno_intnAny, deadline_us);
+		}
+		mask = intnMask();
+	}
+
+	return mask;
+}
+
+bno_waitResult_t bno_waitIntnUntil(int unit, uint32_t deadline_us)
+{
+	bno_t *pDev = &bno_dev[unit];
+
+	// Edges before the wait leave their bit set, as above
+	wakeArm(&pDev->intnWake);
+	while (pDev->intnStatus) {
+		if (!wakeWaitUntil(&pDev->intnWake, deadline_us)) {
+			return pDev->intnStatus ? BNO_WAIT_TIMEOUT : BNO_WAIT_EDGE;
+		}
+	}
+
+	return BNO_WAIT_EDGE;
+}
+
+void bno_getDeadlineStats(bno_deadlineStats_t *pStats)
+{
+	taskENTER_CRITICAL();
+	*pStats = deadlineStats;
+	taskEXIT_CRITICAL();
+}
+
+void bno_setI2cDma(bool dma)
+{
+	bno_i2cDma = dma;
+}
+
+bool bno_getI2cDma(void)
+{
+	return bno_i2cDma;
+}
+
+void bno_getI2cCost(bno_i2cCost_t *pIt, bno_i2cCost_t *pDma)
+{
+	// Updated under the i2c mutex
+	xSemaphoreTake(bno_i2cMutex, portMAX_DELAY);
+	*pIt = i2cCost[0];
+	*pDma = i2cCost[1];
+	xSemaphoreGive(bno_i2cMutex);
+}
+
+void bno_getI2cRecovery(bno_i2cRecovery_t *pStats)
+{
+	xSemaphoreTake(bno_i2cMutex, portMAX_DELAY);
+	*pStats = i2cRecovery;
+	xSemaphoreGive(bno_i2cMutex);
+}
+
+uint32_t bno_i2cBusClears(void)
+{
+	return i2cRecovery.busClears;
+}
+
+void bno_getResetStats(int unit, bno_resetStats_t *pStats)
+{
+	// Written by the task resetting the unit, copy them whole
+	taskENTER_CRITICAL();
+	*pStats = bno_dev[unit].resetStats;
+	taskEXIT_CRITICAL();
+}
+
+void bno_i2cIsrDone(uint32_t startCycles)
+{
+	bno_i2cIsrs++;
+	bno_i2cIsrCycles += DWT->CYCCNT - startCycles;
+}
+
+void bno_getWakeStats(bno_wakeStats_t *pI2c, bno_wakeStats_t *pIntn)
+{
+	// Written by the waiting task, copy them whole
+	taskENTER_CRITICAL();
+	*pI2c = bno_i2cOperationDone.stats;
+	*pIntn = bno_intnAny.stats;
+	taskEXIT_CRITICAL();
+}
+
+void bno_getIntnCaptureStats(bno_intnCaptureStats_t *pStats)
+{
+	// Masks the EXTI and TIM2 interrupts, both at priority 5
+	taskENTER_CRITICAL();
+	*pStats = intnCapture;
+	taskEXIT_CRITICAL();
+}
+
+bool bno_popIntnCompare(bno_intnCompare_t *pEdge)
+{
+	uint32_t tail = intnLogTail;
+
+	if (tail == intnLogHead) {
+		return false;
+	}
+
+	// Read the entry before handing its slot back to the ISR
+	__DMB();
+	*pEdge = intnLog[tail % INTN_LOG_LEN];
+	__DMB();
+	intnLogTail = tail + 1;
+
+	return true;
 }
 
 void HAL_GPIO_EXTI_Callback(uint16_t n)
+{
+	uint32_t timestamp_us = timebase_now32();
+
+	for (int unit = 0; unit < BNO_NUM_UNITS; unit++) {
+		if (bno_dev[unit].intnPin == n) {
+			// Only unit 0's INTN is jumpered to TIM2 CH3
+			if ((unit == 0) && (INTN_TIMESTAMP == BNO_INTN_TS_COMPARE)) {
+				timestamp_us = compareCapture(timestamp_us);
+			}
+
+			intnAsserted(&bno_dev[unit], timestamp_us);
+			return;
+		}
+	}
+}
+
+void bno_captureIrqHandler(void)
+{
+	if ((INTN_TIMESTAMP != BNO_INTN_TS_CAPTURE) ||
+	    !__HAL_TIM_GET_FLAG(htim, TIM_FLAG_CC3)) {
+		return;
+	}
+
+	if (__HAL_TIM_GET_FLAG(htim, TIM_FLAG_CC3OF)) {
+		__HAL_TIM_CLEAR_FLAG(htim, TIM_FLAG_CC3OF);
+		intnCapture.overcaptures++;
+	}
+
+	// Reading the capture clears its flag
+	intnAsserted(&bno_dev[0], HAL_TIM_ReadCapturedValue(htim, TIM_CHANNEL_3));
+}
+
+void bno_deadlineIrqHandler(void)
 {
 	BaseType_t woken = pdFALSE;
-	
-	intn0_timestamp = __HAL_TIM_GET_COUNTER(htim);
-	intn0_sequence++;
 
-	// INTN asserted
-	bno_dev[0].intnStatus = false;
-	
-	xSemaphoreGiveFromISR(bno_dev[0].intnSem, &woken);
+	// CC4 matches whether or not a wait has its interrupt enabled
+	if ((__HAL_TIM_GET_IT_SOURCE(htim, TIM_IT_CC4) == RESET) ||
+	    !__HAL_TIM_GET_FLAG(htim, TIM_FLAG_CC4)) {
+		return;
+	}
+	__HAL_TIM_CLEAR_FLAG(htim, TIM_FLAG_CC4);
+
+	wakeFromISR(&bno_deadline, &woken);
 
 	portYIELD_FROM_ISR(woken);
 }
@@ -335,12 +683,146 @@ void HAL_GPIO_EXTI_Callback(uint16_t n)
 #define INTN_GPIO_PIN  GPIO_PIN_10
 #define INTN_IRQn EXTI15_10_IRQn
 
+// Unit 1: Arduino D9, D8 and D7
+#define RSTN1_GPIO_PORT GPIOC
+#define RSTN1_GPIO_PIN  GPIO_PIN_7
+
+#define BOOTN1_GPIO_PORT GPIOA
+#define BOOTN1_GPIO_PIN  GPIO_PIN_9
+
+#define INTN1_GPIO_PORT GPIOA
+#define INTN1_GPIO_PIN  GPIO_PIN_8
+#define INTN1_IRQn EXTI9_5_IRQn
+
+// I2C1, driven as GPIO to clear the bus
+#define I2C_GPIO_PORT    GPIOB
+#define I2C_SCL_GPIO_PIN GPIO_PIN_8
+#define I2C_SDA_GPIO_PIN GPIO_PIN_9
+
+// TIM2 CH3 input, jumpered to INTN for capture and compare
+#define CAPTURE_GPIO_PORT GPIOB
+#define CAPTURE_GPIO_PIN  GPIO_PIN_10
+
 void bno_init(I2C_HandleTypeDef * _hi2c, TIM_HandleTypeDef * _htim)
 {
 	hi2c = _hi2c;
 	htim = _htim;
 
-	HAL_TIM_Base_Start(htim);
+	timebase_init(htim);
+
+	// Cycle counter for I2C cost accounting
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	if (INTN_TIMESTAMP != BNO_INTN_TS_EXTI) {
+		initCapture();
+	}
+
+	if (BNO_NUM_UNITS > 1) {
+		initUnit1();
+	}
+}
+
+// Units with INTN asserted, bit n for unit n.
+static uint32_t intnMask(void)
+{
+	uint32_t mask = 0;
+
+	for (int unit = 0; unit < BNO_NUM_UNITS; unit++) {
+		if (!bno_dev[unit].intnStatus) {
+			mask |= 1u << unit;
+		}
+	}
+
+	return mask;
+}
+
+// INTN edge on a unit, from whichever ISR timed it.
+static void intnAsserted(bno_t *pDev, uint32_t timestamp_us)
+{
+	BaseType_t woken = pdFALSE;
+	
+	pDev->intnSequence++;
+	intnFifo_push(&pDev->intnFifo, timestamp_us, pDev->intnSequence);
+
+	// INTN asserted
+	pDev->intnStatus = false;
+	
+	wakeFromISR(&pDev->intnWake, &woken);
+	wakeFromISR(&bno_intnAny, &woken);
+
+	portYIELD_FROM_ISR(woken);
+}
+
+// Compare mode: pair the EXTI time of an edge with the time TIM2 CH3
+// latched for it, and log both.  Returns the capture time, or the EXTI
+// time if nothing was captured.  Call from the EXTI ISR.
+static uint32_t compareCapture(uint32_t software_us)
+{
+	if (!__HAL_TIM_GET_FLAG(htim, TIM_FLAG_CC3)) {
+		intnCapture.missed++;
+		return software_us;
+	}
+
+	if (__HAL_TIM_GET_FLAG(htim, TIM_FLAG_CC3OF)) {
+		// Capture holds a later edge than this one
+		__HAL_TIM_CLEAR_FLAG(htim, TIM_FLAG_CC3OF);
+		intnCapture.overcaptures++;
+	}
+	uint32_t capture_us = HAL_TIM_ReadCapturedValue(htim, TIM_CHANNEL_3);
+	uint32_t latency_us = software_us - capture_us;
+
+	intnCapture.compared++;
+	intnCapture.totalLatency_us += latency_us;
+	if (latency_us < intnCapture.minLatency_us) {
+		intnCapture.minLatency_us = latency_us;
+	}
+	if (latency_us > intnCapture.maxLatency_us) {
+		intnCapture.maxLatency_us = latency_us;
+	}
+
+	uint32_t head = intnLogHead;
+	if ((head - intnLogTail) < INTN_LOG_LEN) {
+		bno_intnCompare_t *pEdge = &intnLog[head % INTN_LOG_LEN];
+		pEdge->sequence = bno_dev[0].intnSequence + 1;
+		pEdge->capture_us = capture_us;
+		pEdge->software_us = software_us;
+		__DMB();
+		intnLogHead = head + 1;
+	}
+	else {
+		intnCapture.logDrops++;
+	}
+
+	return capture_us;
+}
+
+// Latch INTN falling edges in TIM2 CH3.  In capture mode its interrupt
+// replaces EXTI; in compare mode EXTI reads it.
+static void initCapture(void)
+{
+	GPIO_InitTypeDef GPIO_InitStruct;
+	TIM_IC_InitTypeDef icConfig;
+
+	GPIO_InitStruct.Pin = CAPTURE_GPIO_PIN;
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_PULLUP;
+	GPIO_InitStruct.Speed = GPIO_SPEED_LOW;
+	GPIO_InitStruct.Alternate = GPIO_AF1_TIM2;
+	HAL_GPIO_Init(CAPTURE_GPIO_PORT, &GPIO_InitStruct);
+
+	icConfig.ICPolarity = TIM_ICPOLARITY_FALLING;
+	icConfig.ICSelection = TIM_ICSELECTION_DIRECTTI;
+	icConfig.ICPrescaler = TIM_ICPSC_DIV1;
+	icConfig.ICFilter = 0;
+	HAL_TIM_IC_ConfigChannel(htim, &icConfig, TIM_CHANNEL_3);
+
+	__HAL_TIM_CLEAR_FLAG(htim, TIM_FLAG_CC3 | TIM_FLAG_CC3OF);
+	if (INTN_TIMESTAMP == BNO_INTN_TS_CAPTURE) {
+		HAL_NVIC_DisableIRQ(INTN_IRQn);
+		__HAL_TIM_ENABLE_IT(htim, TIM_IT_CC3);
+	}
+	HAL_TIM_IC_Start(htim, TIM_CHANNEL_3);
 }
 
 static void setBootN_0(bool state)
@@ -360,6 +842,370 @@ static bool getIntN_0(void)
 	return HAL_GPIO_ReadPin(INTN_GPIO_PORT, INTN_GPIO_PIN);
 }
 
+// Unit 1 pins aren't in the CubeMX project; set them up like unit 0's.
+static void initUnit1(void)
+{
+	GPIO_InitTypeDef GPIO_InitStruct;
+
+	__GPIOC_CLK_ENABLE();
+
+	GPIO_InitStruct.Pin = INTN1_GPIO_PIN;
+	GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
+	GPIO_InitStruct.Pull = GPIO_PULLUP;
+	HAL_GPIO_Init(INTN1_GPIO_PORT, &GPIO_InitStruct);
+
+	GPIO_InitStruct.Pin = BOOTN1_GPIO_PIN;
+	GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_LOW;
+	HAL_GPIO_Init(BOOTN1_GPIO_PORT, &GPIO_InitStruct);
+	HAL_GPIO_WritePin(BOOTN1_GPIO_PORT, BOOTN1_GPIO_PIN, GPIO_PIN_RESET);
+
+	GPIO_InitStruct.Pin = RSTN1_GPIO_PIN;
+	HAL_GPIO_Init(RSTN1_GPIO_PORT, &GPIO_InitStruct);
+	HAL_GPIO_WritePin(RSTN1_GPIO_PORT, RSTN1_GPIO_PIN, GPIO_PIN_RESET);
+
+	HAL_NVIC_SetPriority(INTN1_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(INTN1_IRQn);
+}
+
+static void setBootN_1(bool state)
+{
+	HAL_GPIO_WritePin(BOOTN1_GPIO_PORT, BOOTN1_GPIO_PIN, 
+	                  state ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
+static void setRstN_1(bool state)
+{
+	HAL_GPIO_WritePin(RSTN1_GPIO_PORT, RSTN1_GPIO_PIN, 
+	                  state ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
+static bool getIntN_1(void)
+{
+	return HAL_GPIO_ReadPin(INTN1_GPIO_PORT, INTN1_GPIO_PIN);
+}
+
+// One attempt at a transfer.  Returns HAL_OK, or an error with *pFault
+// set.  Call holding the i2c mutex.
+static int i2cTransfer(uint16_t i2cAddr,
+                       const uint8_t *pSend, unsigned sendLen,
+                       uint8_t *pReceive, unsigned receiveLen,
+                       bno_i2cFault_t *pFault)
+{
+	int rc;
+
+	// The HAL would spin for seconds on a bus held low, check it first
+	if (!i2cIdle()) {
+		*pFault = BNO_I2C_FAULT_BUSY;
+		return HAL_BUSY;
+	}
+
+	bno_i2cStatus = SH_STATUS_SUCCESS;
+	wakeArm(&bno_i2cOperationDone);
+	
+	// Cost accounting for reads
+	bool dma = bno_i2cDma && (receiveLen >= I2C_DMA_MIN_LEN);
+	uint32_t isrs = bno_i2cIsrs;
+	uint32_t isrCycles = bno_i2cIsrCycles;
+	uint32_t taskCycles = 0;
+	uint32_t start;
+
+	if ((sendLen != 0) && (receiveLen != 0)) {
+		if (dma && (sendLen <= 2)) {
+			// The write is a one or two byte register: send it as the
+			// memory address, then read by DMA after the repeated start.
+			uint16_t reg = (sendLen == 1) ? pSend[0] : ((pSend[0] << 8) | pSend[1]);
+			start = DWT->CYCCNT;
+			rc = HAL_I2C_Mem_Read_DMA(hi2c, i2cAddr, reg,
+			                          (sendLen == 1) ? I2C_MEMADD_SIZE_8BIT : I2C_MEMADD_SIZE_16BIT,
+			                          pReceive, receiveLen);
+			taskCycles += DWT->CYCCNT - start;
+		}
+		else {
+			// Perform write, then read with repeated start
+			dma = false;
+			start = DWT->CYCCNT;
+			rc = HAL_I2C_Master_Sequential_Transmit_IT(hi2c, i2cAddr,
+			                                           (uint8_t *)pSend, sendLen,
+			                                           I2C_FIRST_FRAME);
+			taskCycles += DWT->CYCCNT - start;
+
+			// Transfer portion started, wait until it finishes.
+			rc = i2cFinish(rc, pFault);
+			if (rc != HAL_OK) {
+				return rc;
+			}
+
+			// Finish with receive portion.
+			wakeArm(&bno_i2cOperationDone);
+			start = DWT->CYCCNT;
+			rc = HAL_I2C_Master_Sequential_Receive_IT(hi2c, i2cAddr,
+			                                          pReceive, receiveLen,
+			                                          I2C_LAST_FRAME);
+			taskCycles += DWT->CYCCNT - start;
+		}
+	}
+	else if (sendLen != 0) {
+		// Perform write only
+		rc = HAL_I2C_Master_Transmit_IT(hi2c, i2cAddr,
+		                             (uint8_t *)pSend, sendLen);
+	}
+	else {
+		// Perform read only
+		start = DWT->CYCCNT;
+		if (dma) {
+			rc = HAL_I2C_Master_Receive_DMA(hi2c, i2cAddr,
+			                                pReceive, receiveLen);
+		}
+		else {
+			rc = HAL_I2C_Master_Receive_IT(hi2c, i2cAddr,
+			                               pReceive, receiveLen);
+		}
+		taskCycles += DWT->CYCCNT - start;
+	}
+
+	// Wait until operation finishes.
+	rc = i2cFinish(rc, pFault);
+
+	if ((rc == HAL_OK) && (receiveLen != 0)) {
+		bno_i2cCost_t *pCost = &i2cCost[dma ? 1 : 0];
+		pCost->transfers++;
+		pCost->bytes += sendLen + receiveLen;
+		pCost->isrs += bno_i2cIsrs - isrs;
+		pCost->cycles += (bno_i2cIsrCycles - isrCycles) + taskCycles;
+	}
+
+	return rc;
+}
+
+// Wait for an operation the HAL started (rc HAL_OK) to finish.  Returns
+// HAL_OK, or an error with *pFault set.
+static int i2cFinish(int rc, bno_i2cFault_t *pFault)
+{
+	if (rc == HAL_BUSY) {
+		*pFault = BNO_I2C_FAULT_BUSY;
+		return rc;
+	}
+	if (rc == HAL_TIMEOUT) {
+		*pFault = BNO_I2C_FAULT_TIMEOUT;
+		return rc;
+	}
+	if (rc != HAL_OK) {
+		// Address not acknowledged, or the HAL wasn't ready
+		*pFault = (hi2c->ErrorCode & HAL_I2C_ERROR_AF) ?
+			BNO_I2C_FAULT_NACK : BNO_I2C_FAULT_START;
+		return rc;
+	}
+
+	if (!wakeWait(&bno_i2cOperationDone,
+	              timebase_ticksFor(I2C_XFER_TIMEOUT_MS * 1000, configTICK_RATE_HZ))) {
+		*pFault = BNO_I2C_FAULT_TIMEOUT;
+		return HAL_TIMEOUT;
+	}
+
+	if (bno_i2cStatus != SH_STATUS_SUCCESS) {
+		uint32_t error = bno_i2cErrorCode;
+
+		if (error & HAL_I2C_ERROR_BERR) {
+			*pFault = BNO_I2C_FAULT_BUS;
+		}
+		else if (error & HAL_I2C_ERROR_ARLO) {
+			*pFault = BNO_I2C_FAULT_ARLO;
+		}
+		else if (error & HAL_I2C_ERROR_OVR) {
+			*pFault = BNO_I2C_FAULT_OVR;
+		}
+		else if (error & HAL_I2C_ERROR_DMA) {
+			*pFault = BNO_I2C_FAULT_DMA;
+		}
+		else {
+			*pFault = BNO_I2C_FAULT_NACK;
+		}
+		return HAL_ERROR;
+	}
+
+	return HAL_OK;
+}
+
+// Wait briefly for the STOP of the last transfer to clear BUSY.  Returns
+// false if the bus stays busy.
+static bool i2cIdle(void)
+{
+	uint32_t start_us = timebase_now32();
+
+	while (__HAL_I2C_GET_FLAG(hi2c, I2C_FLAG_BUSY)) {
+		if ((timebase_now32() - start_us) > I2C_IDLE_TIMEOUT_US) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Put I2C1 back in working order after a fault.  Call holding the i2c
+// mutex.
+static void i2cRecover(bno_i2cFault_t fault)
+{
+	// Faults on the wire may have left a slave driving SDA
+	bool stuck = (fault == BNO_I2C_FAULT_BUSY) || (fault == BNO_I2C_FAULT_TIMEOUT) ||
+		(fault == BNO_I2C_FAULT_BUS) || (fault == BNO_I2C_FAULT_ARLO);
+
+	// A fault can leave the DMA stream mid-transfer.  (HAL_DMA_DeInit
+	// refuses a busy stream.)
+	if ((hi2c->hdmarx != 0) && (hi2c->hdmarx->State == HAL_DMA_STATE_BUSY)) {
+		HAL_DMA_Abort(hi2c->hdmarx);
+	}
+
+	// Otherwise (a hub busy or in reset NACKs its address, say) the HAL
+	// has sent the STOP and the peripheral is fine: just retry.
+	if (stuck || (hi2c->State != HAL_I2C_STATE_READY)) {
+		hi2c->Instance->CR1 |= I2C_CR1_SWRST;
+		hi2c->Instance->CR1 &= ~I2C_CR1_SWRST;
+		HAL_I2C_DeInit(hi2c);
+		if (stuck) {
+			i2cBusClear();
+		}
+		HAL_I2C_Init(hi2c);
+		i2cRecovery.reinits++;
+	}
+
+	// Drop a completion that came in after its wait gave up
+	wakeCancel(&bno_i2cOperationDone);
+}
+
+// Clock out a slave stuck mid-byte: pulse SCL until it lets SDA go, then
+// send a STOP.  Call with I2C1 deinitialized.
+static void i2cBusClear(void)
+{
+	GPIO_InitTypeDef GPIO_InitStruct;
+
+	HAL_GPIO_WritePin(I2C_GPIO_PORT, I2C_SCL_GPIO_PIN | I2C_SDA_GPIO_PIN,
+	                  GPIO_PIN_SET);
+	GPIO_InitStruct.Pin = I2C_SCL_GPIO_PIN | I2C_SDA_GPIO_PIN;
+	GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_OD;
+	GPIO_InitStruct.Pull = GPIO_PULLUP;
+	GPIO_InitStruct.Speed = GPIO_SPEED_LOW;
+	HAL_GPIO_Init(I2C_GPIO_PORT, &GPIO_InitStruct);
+	spinUs(I2C_CLEAR_HALF_US);
+
+	for (int n = 0; n < I2C_CLEAR_PULSES; n++) {
+		if (HAL_GPIO_ReadPin(I2C_GPIO_PORT, I2C_SDA_GPIO_PIN)) {
+			break;
+		}
+		HAL_GPIO_WritePin(I2C_GPIO_PORT, I2C_SCL_GPIO_PIN, GPIO_PIN_RESET);
+		spinUs(I2C_CLEAR_HALF_US);
+		HAL_GPIO_WritePin(I2C_GPIO_PORT, I2C_SCL_GPIO_PIN, GPIO_PIN_SET);
+		spinUs(I2C_CLEAR_HALF_US);
+	}
+
+	// START then STOP, SDA falling then rising with SCL high
+	HAL_GPIO_WritePin(I2C_GPIO_PORT, I2C_SDA_GPIO_PIN, GPIO_PIN_RESET);
+	spinUs(I2C_CLEAR_HALF_US);
+	HAL_GPIO_WritePin(I2C_GPIO_PORT, I2C_SDA_GPIO_PIN, GPIO_PIN_SET);
+	spinUs(I2C_CLEAR_HALF_US);
+
+	i2cRecovery.busClears++;
+	if (!HAL_GPIO_ReadPin(I2C_GPIO_PORT, I2C_SDA_GPIO_PIN) ||
+	    !HAL_GPIO_ReadPin(I2C_GPIO_PORT, I2C_SCL_GPIO_PIN)) {
+		// Something still holds the bus
+		i2cRecovery.stuck++;
+	}
+
+	// HAL_I2C_Init puts the pins back on I2C1
+	HAL_GPIO_DeInit(I2C_GPIO_PORT, I2C_SCL_GPIO_PIN | I2C_SDA_GPIO_PIN);
+}
+
+// Busy wait at least wait_us, for delays shorter than a tick.
+static void spinUs(uint32_t wait_us)
+{
+	uint32_t start_us = timebase_now32();
+
+	while ((timebase_now32() - start_us) <= wait_us) {
+		// spin
+	}
+}
+
+// Hold a unit in reset for RESET_PULSE_US, then forget its INTN state.
+static void resetPulse(bno_t *pDev)
+{
+	pDev->setRstN(false);
+	spinUs(RESET_PULSE_US);
+
+	// INTN deasserted, edges from before the reset will never be read
+	pDev->intnStatus = true;
+	intnFifo_flush(&pDev->intnFifo);
+	wakeArm(&pDev->intnWake);
+	wakeCancel(&pDev->intnWake);
+}
+
+// Poll the bootloader address once a tick until it's acknowledged.
+// Returns false if it wasn't within MAX_WAIT_FOR_DATA.
+static bool waitBootloaderReady(bno_t *pDev)
+{
+	uint16_t i2cAddr = ((pDev->unit == 0) ? BNO_DFU_I2C_0 : BNO_DFU_I2C_1) << 1;
+	TickType_t start = xTaskGetTickCount();
+	bool ready = false;
+
+	while (!ready) {
+		xSemaphoreTake(bno_i2cMutex, portMAX_DELAY);
+		// HAL_I2C_IsDeviceReady would spin for seconds on a busy bus
+		ready = i2cIdle() &&
+			(HAL_I2C_IsDeviceReady(hi2c, i2cAddr, 1, 1) == HAL_OK);
+		xSemaphoreGive(bno_i2cMutex);
+
+		if (!ready) {
+			if ((xTaskGetTickCount() - start) >=
+			    timebase_ticksFor(MAX_WAIT_FOR_DATA * 1000, configTICK_RATE_HZ)) {
+				return false;
+			}
+			vTaskDelay(1);
+		}
+	}
+
+	return true;
+}
+
+// Count a reset released at release_us.
+static void resetDone(bno_t *pDev, bool ready, uint32_t release_us)
+{
+	uint32_t ready_us = timebase_now32() - release_us;
+	bno_resetStats_t stats = pDev->resetStats;
+
+	stats.resets++;
+	if (!ready) {
+		stats.timeouts++;
+	}
+	else {
+		stats.lastReady_us = ready_us;
+		if (ready_us < stats.minReady_us) {
+			stats.minReady_us = ready_us;
+		}
+		if (ready_us > stats.maxReady_us) {
+			stats.maxReady_us = ready_us;
+		}
+	}
+
+	taskENTER_CRITICAL();
+	pDev->resetStats = stats;
+	taskEXIT_CRITICAL();
+}
+
+// A transfer succeeded after faults that started at firstFault_us.
+static void i2cRecovered(uint32_t firstFault_us)
+{
+	uint32_t recover_us = timebase_now32() - firstFault_us;
+
+	i2cRecovery.recovered++;
+	i2cRecovery.totalRecover_us += recover_us;
+	if (recover_us < i2cRecovery.minRecover_us) {
+		i2cRecovery.minRecover_us = recover_us;
+	}
+	if (recover_us > i2cRecovery.maxRecover_us) {
+		i2cRecovery.maxRecover_us = recover_us;
+	}
+}
+
 void HAL_I2C_MasterXferCpltCallback(I2C_HandleTypeDef * hi2c)
 {
 	BaseType_t woken= pdFALSE;
@@ -367,7 +1213,7 @@ void HAL_I2C_MasterXferCpltCallback(I2C_HandleTypeDef * hi2c)
 	bno_i2cStatus = SH_STATUS_SUCCESS;
 
 	// An operation finished, unblock anyone waiting on it
-	xSemaphoreGiveFromISR(bno_i2cOperationDone, &woken);
+	wakeFromISR(&bno_i2cOperationDone, &woken);
 
 	portEND_SWITCHING_ISR(woken);
 }
@@ -379,7 +1225,7 @@ void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef * hi2c)
 	bno_i2cStatus = SH_STATUS_SUCCESS;
 
 	// An operation finished, unblock anyone waiting on it
-	xSemaphoreGiveFromISR(bno_i2cOperationDone, &woken);
+	wakeFromISR(&bno_i2cOperationDone, &woken);
 
 	portEND_SWITCHING_ISR(woken);
 }
@@ -391,7 +1237,19 @@ void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef * hi2c)
 	bno_i2cStatus = SH_STATUS_SUCCESS;
 
 	// An operation finished, unblock anyone waiting on it
-	xSemaphoreGiveFromISR(bno_i2cOperationDone, &woken);
+	wakeFromISR(&bno_i2cOperationDone, &woken);
+
+	portEND_SWITCHING_ISR(woken);
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef * hi2c)
+{
+	BaseType_t woken= pdFALSE;
+
+	bno_i2cStatus = SH_STATUS_SUCCESS;
+
+	// A DMA register read finished, unblock anyone waiting on it
+	wakeFromISR(&bno_i2cOperationDone, &woken);
 
 	portEND_SWITCHING_ISR(woken);
 }
@@ -401,10 +1259,224 @@ void HAL_I2C_ErrorCallback(I2C_HandleTypeDef * hi2c)
 	BaseType_t woken= pdFALSE;
 
 	bno_i2cErrors++;
+	bno_i2cErrorCode = hi2c->ErrorCode;
 	bno_i2cStatus = SH_STATUS_ERROR_I2C_IO;
 
 	// An operation finished, unblock anyone waiting on it
-	xSemaphoreGiveFromISR(bno_i2cOperationDone, &woken);
+	wakeFromISR(&bno_i2cOperationDone, &woken);
 
 	portEND_SWITCHING_ISR(woken);
 }
+
+static void wakeInit(wake_t *pWake, unsigned bit)
+{
+	pWake->bit = 1u << bit;
+	pWake->task = 0;
+	pWake->pending = false;
+	pWake->signal_us = 0;
+	pWake->stats.wakeups = 0;
+	pWake->stats.minLatency_us = UINT32_MAX;
+	pWake->stats.maxLatency_us = 0;
+	pWake->stats.totalLatency_us = 0;
+#ifdef WAKE_BY_SEMAPHORE
+	pWake->sem = xSemaphoreCreateBinary();
+	pWake->stats.semaphore = true;
+#else
+	pWake->sem = 0;
+	pWake->stats.semaphore = false;
+#endif
+
+	wakeByBit[bit] = pWake;
+}
+
+// Direct wakeups to the calling task.
+static void wakeArm(wake_t *pWake)
+{
+	pWake->task = xTaskGetCurrentTaskHandle();
+}
+
+static void wakeFromISR(wake_t *pWake, BaseType_t *pWoken)
+{
+	pWake->signal_us = timebase_now32();
+
+#ifdef WAKE_BY_SEMAPHORE
+	xSemaphoreGiveFromISR(pWake->sem, pWoken);
+#else
+	if (pWake->task != 0) {
+		xTaskNotifyFromISR(pWake->task, pWake->bit, eSetBits, pWoken);
+	}
+#endif
+}
+
+// Block until the ISR signals or ticks pass.  Returns false on timeout.
+static bool wakeWait(wake_t *pWake, TickType_t ticks)
+{
+	uint32_t start_us = timebase_now32();
+	bool woken;
+
+#ifdef WAKE_BY_SEMAPHORE
+	woken = (xSemaphoreTake(pWake->sem, ticks) == pdPASS);
+#else
+	TickType_t start = xTaskGetTickCount();
+	TickType_t remaining = ticks;
+	uint32_t bits;
+
+	while (!pWake->pending) {
+		if (xTaskNotifyWait(0, UINT32_MAX, &bits, remaining) != pdTRUE) {
+			// Timed out
+			break;
+		}
+
+		// Hand out every bit received, some may be for other waits
+		wakeDispatch(bits);
+
+		if (ticks != portMAX_DELAY) {
+			TickType_t elapsed = xTaskGetTickCount() - start;
+			remaining = (elapsed < ticks) ? (ticks - elapsed) : 0;
+		}
+	}
+	woken = pWake->pending;
+	pWake->pending = false;
+#endif
+
+	wakeLatency(pWake, woken, start_us);
+
+	return woken;
+}
+
+// Block until the ISR signals or timebase_now32() reaches deadline_us.
+// TIM2 CH4 wakes the task at the deadline, which needn't fall on a tick.
+// Returns false on timeout.
+static bool wakeWaitUntil(wake_t *pWake, uint32_t deadline_us)
+{
+	uint32_t start_us = timebase_now32();
+	int32_t remaining_us;
+	bool woken;
+
+#ifdef WAKE_BY_SEMAPHORE
+	// To the tick only: the compare can't also wake a semaphore wait
+	woken = false;
+	while (!woken) {
+		remaining_us = (int32_t)(deadline_us - timebase_now32());
+		if (remaining_us <= 0) {
+			break;
+		}
+		woken = (xSemaphoreTake(pWake->sem,
+		                        timebase_ticksFor(remaining_us, configTICK_RATE_HZ)) == pdPASS);
+	}
+#else
+	uint32_t bits;
+
+	wakeArm(&bno_deadline);
+	deadlineStart(deadline_us);
+	while (!pWake->pending) {
+		// Checked after the compare is set, so the match is still to come
+		remaining_us = (int32_t)(deadline_us - timebase_now32());
+		if (remaining_us <= 0) {
+			break;
+		}
+
+		// The compare ends the wait; the tick timeout only backs it up
+		if (xTaskNotifyWait(0, UINT32_MAX, &bits,
+		                    timebase_ticksFor(remaining_us, configTICK_RATE_HZ) + 1) == pdTRUE) {
+			wakeDispatch(bits);
+		}
+	}
+	deadlineStop();
+	bno_deadline.pending = false;
+	woken = pWake->pending;
+	pWake->pending = false;
+#endif
+
+	wakeLatency(pWake, woken, start_us);
+	deadlineDone(woken, deadline_us);
+
+	return woken;
+}
+
+// Resume latency, for waits that were blocked when the ISR signalled.
+static void wakeLatency(wake_t *pWake, bool woken, uint32_t start_us)
+{
+	if (woken && ((int32_t)(pWake->signal_us - start_us) >= 0)) {
+		uint32_t latency_us = timebase_now32() - pWake->signal_us;
+
+		pWake->stats.wakeups++;
+		pWake->stats.totalLatency_us += latency_us;
+		if (latency_us < pWake->stats.minLatency_us) {
+			pWake->stats.minLatency_us = latency_us;
+		}
+		if (latency_us > pWake->stats.maxLatency_us) {
+			pWake->stats.maxLatency_us = latency_us;
+		}
+	}
+}
+
+// Interrupt on TIM2 CH4 when the counter reaches deadline_us.
+static void deadlineStart(uint32_t deadline_us)
+{
+	__HAL_TIM_SET_COMPARE(htim, TIM_CHANNEL_4, deadline_us);
+	__HAL_TIM_CLEAR_FLAG(htim, TIM_FLAG_CC4);
+	__HAL_TIM_ENABLE_IT(htim, TIM_IT_CC4);
+}
+
+static void deadlineStop(void)
+{
+	__HAL_TIM_DISABLE_IT(htim, TIM_IT_CC4);
+	__HAL_TIM_CLEAR_FLAG(htim, TIM_FLAG_CC4);
+}
+
+// Count a wait for deadline_us, and how late a timeout returned.
+static void deadlineDone(bool woken, uint32_t deadline_us)
+{
+	bno_deadlineStats_t stats = deadlineStats;
+
+	stats.waits++;
+	if (!woken) {
+		uint32_t late_us = timebase_now32() - deadline_us;
+
+		stats.timeouts++;
+		stats.totalLate_us += late_us;
+		if (late_us > stats.maxLate_us) {
+			stats.maxLate_us = late_us;
+		}
+	}
+
+	taskENTER_CRITICAL();
+	deadlineStats = stats;
+	taskEXIT_CRITICAL();
+}
+
+// Drop a signal that came in after its wait timed out.
+static void wakeCancel(wake_t *pWake)
+{
+#ifdef WAKE_BY_SEMAPHORE
+	xSemaphoreTake(pWake->sem, 0);
+#else
+	uint32_t bits;
+
+	if (xTaskNotifyWait(0, UINT32_MAX, &bits, 0) == pdTRUE) {
+		wakeDispatch(bits);
+	}
+#endif
+	pWake->pending = false;
+}
+
+// Signal a wakeup again, for one that was taken early.
+static void wakeRepost(wake_t *pWake)
+{
+#ifdef WAKE_BY_SEMAPHORE
+	xSemaphoreGive(pWake->sem);
+#else
+	pWake->pending = true;
+#endif
+}
+
+// Mark the wakeups for notification bits received.
+static void wakeDispatch(uint32_t bits)
+{
+	for (unsigned n = 0; n < WAKE_NUM_BITS; n++) {
+		if ((bits & (1u << n)) && (wakeByBit[n] != 0)) {
+			wakeByBit[n]->pending = true;
+		}
+	}
+}
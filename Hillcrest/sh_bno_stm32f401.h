@@ -19,8 +19,162 @@
 #ifndef BNO070_H
 #define BNO070_H
 
+#include <stdbool.h>
+
 #include "stm32f4xx_hal.h"
+#include "intn_fifo.h"
+
+// Where INTN edge times come from, chosen by INTN_TIMESTAMP in
+// sh_bno_stm32f401.c.  Capture and compare need INTN (PA10, Arduino D2)
+// jumpered to PB10 (D6), TIM2 channel 3.
+typedef enum {
+	BNO_INTN_TS_EXTI,     // timer read by the EXTI ISR
+	BNO_INTN_TS_CAPTURE,  // latched by TIM2 CH3, read by its ISR
+	BNO_INTN_TS_COMPARE,  // capture and EXTI times logged for each edge
+} bno_intnTimestamp_t;
+
+// One edge timed both ways (compare mode).
+typedef struct bno_intnCompare_s {
+	uint32_t sequence;
+	uint32_t capture_us;   // latched by TIM2 CH3 at the edge
+	uint32_t software_us;  // read by the EXTI ISR
+} bno_intnCompare_t;
+
+typedef struct bno_intnCaptureStats_s {
+	bno_intnTimestamp_t mode;
+	uint32_t missed;        // edges TIM2 CH3 didn't latch
+	uint32_t overcaptures;  // edges overwritten before they were read
+	// Compare mode: EXTI time minus capture time, over all paired edges
+	uint32_t compared;
+	uint32_t minLatency_us;
+	uint32_t maxLatency_us;
+	uint64_t totalLatency_us;
+	uint32_t logDrops;      // pairs lost, log full
+} bno_intnCaptureStats_t;
+
+// Time from an ISR signalling a task to the task running, on TIM2.
+typedef struct bno_wakeStats_s {
+	bool semaphore;         // woken by semaphore, not task notification
+	uint32_t wakeups;
+	uint32_t minLatency_us;
+	uint32_t maxLatency_us;
+	uint64_t totalLatency_us;
+} bno_wakeStats_t;
+
+// CPU cost of I2C reads: interrupt entries and cycles, in the I2C and
+// DMA ISRs plus the task starting each transfer.
+typedef struct bno_i2cCost_s {
+	uint32_t transfers;
+	uint32_t bytes;
+	uint32_t isrs;
+	uint64_t cycles;
+} bno_i2cCost_t;
+
+// Classes of I2C failure, each retried after recovering the bus.
+typedef enum {
+	BNO_I2C_FAULT_NACK,     // address or data not acknowledged
+	BNO_I2C_FAULT_BUS,      // misplaced START or STOP (BERR)
+	BNO_I2C_FAULT_ARLO,     // arbitration lost
+	BNO_I2C_FAULT_OVR,      // overrun
+	BNO_I2C_FAULT_DMA,      // DMA transfer error
+	BNO_I2C_FAULT_TIMEOUT,  // transfer never finished
+	BNO_I2C_FAULT_BUSY,     // bus held low before the start
+	BNO_I2C_FAULT_START,    // HAL wouldn't start the transfer
+	BNO_I2C_NUM_FAULTS
+} bno_i2cFault_t;
+
+typedef struct bno_i2cRecovery_s {
+	uint32_t faults[BNO_I2C_NUM_FAULTS];
+	uint32_t retries;       // attempts after the first
+	uint32_t recovered;     // transfers that succeeded on a retry
+	uint32_t failed;        // transfers that ran out of attempts
+	uint32_t reinits;       // I2C1 resets and re-initializations
+	uint32_t busClears;     // SCL pulse trains sent by GPIO
+	uint32_t stuck;         // bus clears that left a line low
+	// Time from a transfer's first fault to its success
+	uint32_t minRecover_us;
+	uint32_t maxRecover_us;
+	uint64_t totalRecover_us;
+} bno_i2cRecovery_t;
+
+// Time from releasing RSTN to the hub asserting INTN, or the bootloader
+// acknowledging its address.
+typedef struct bno_resetStats_s {
+	uint32_t resets;
+	uint32_t timeouts;      // never ready, carried on after the timeout
+	uint32_t lastReady_us;
+	uint32_t minReady_us;
+	uint32_t maxReady_us;
+} bno_resetStats_t;
+
+// How a wait for INTN ended.
+typedef enum {
+	BNO_WAIT_EDGE,          // INTN asserted
+	BNO_WAIT_TIMEOUT,       // the deadline came first
+} bno_waitResult_t;
+
+// Waits for INTN until a deadline, and how late the ones that timed out
+// returned.
+typedef struct bno_deadlineStats_s {
+	uint32_t waits;
+	uint32_t timeouts;
+	uint32_t maxLate_us;
+	uint64_t totalLate_us;
+} bno_deadlineStats_t;
 
 void bno_init(I2C_HandleTypeDef * _hi2c, TIM_HandleTypeDef * _htim);
 
+// Read INTN edge counters for a unit.
+void bno_getIntnStats(int unit, intnFifo_stats_t *pStats);
+
+// Number of hubs fitted, units 0 to bno_numUnits()-1.
+unsigned bno_numUnits(void);
+
+// Wait up to wait_ms (or SH_WAIT_FOREVER) for INTN on any unit.  Returns
+// the units with INTN asserted, bit n for unit n; 0 on timeout.
+uint32_t bno_waitIntnAny(uint32_t wait_ms);
+
+// Wait for INTN on a unit until timebase_now32() reaches deadline_us,
+// which may be less than a tick away.  Returns at once if INTN is already
+// asserted.  One task at a time may wait with a deadline.
+bno_waitResult_t bno_waitIntnUntil(int unit, uint32_t deadline_us);
+
+// Read counters of waits with deadlines.
+void bno_getDeadlineStats(bno_deadlineStats_t *pStats);
+
+// Read HID reports by DMA (true) or an interrupt per byte (false).
+void bno_setI2cDma(bool dma);
+bool bno_getI2cDma(void);
+
+// Read the cost of reads by interrupt and by DMA.
+void bno_getI2cCost(bno_i2cCost_t *pIt, bno_i2cCost_t *pDma);
+
+// Read I2C fault and recovery counters.
+void bno_getI2cRecovery(bno_i2cRecovery_t *pStats);
+
+// Bus clears so far.  Hubs may have missed commands across each one.
+uint32_t bno_i2cBusClears(void);
+
+// Read reset counters for a unit.
+void bno_getResetStats(int unit, bno_resetStats_t *pStats);
+
+// Count an I2C or I2C DMA ISR that started at DWT->CYCCNT startCycles.
+void bno_i2cIsrDone(uint32_t startCycles);
+
+// Read ISR to task resume latency, for I2C completion and INTN (waits in
+// bno_waitIntnAny).
+void bno_getWakeStats(bno_wakeStats_t *pI2c, bno_wakeStats_t *pIntn);
+
+// Read INTN capture and compare counters.
+void bno_getIntnCaptureStats(bno_intnCaptureStats_t *pStats);
+
+// Compare mode: take the oldest logged edge.  Returns false if none.
+bool bno_popIntnCompare(bno_intnCompare_t *pEdge);
+
+// TIM2 capture interrupt, called from TIM2_IRQHandler.
+void bno_captureIrqHandler(void);
+
+// TIM2 CH4 deadline interrupt, called from TIM2_IRQHandler.
+void bno_deadlineIrqHandler(void);
+
 #endif
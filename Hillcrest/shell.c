@@ -0,0 +1,446 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+// Line oriented command shell on the console.
+// Reconfigures sensors and output while the event loop keeps running.
+
+#include "shell.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "SensorHub.h"
+#include "sensor_app.h"
+#include "console.h"
+#include "sh_bno_stm32f401.h"
+#include "cpu_stats.h"
+#include "rtos_pool.h"
+#include "app_tasks.h"
+#include "prof.h"
+
+#define SHELL_LINE_LEN (80)
+#define SHELL_MAX_ARGS (4)
+
+// --- Type Definitions ---------------------------------------------------
+
+typedef struct command_s {
+	const char *name;
+	const char *usage;
+	void (*handler)(int argc, char *argv[]);
+} command_t;
+
+// --- Forward Declarations ------------------------------------------------
+
+static void cmdHelp(int argc, char *argv[]);
+static void cmdSensors(int argc, char *argv[]);
+static void cmdEnable(int argc, char *argv[]);
+static void cmdDisable(int argc, char *argv[]);
+static void cmdRate(int argc, char *argv[]);
+static void cmdSens(int argc, char *argv[]);
+static void cmdFormat(int argc, char *argv[]);
+static void cmdStats(int argc, char *argv[]);
+static void cmdBaud(int argc, char *argv[]);
+static void cmdIntn(int argc, char *argv[]);
+static void cmdI2c(int argc, char *argv[]);
+static void cmdTop(int argc, char *argv[]);
+static void cmdMem(int argc, char *argv[]);
+static void cmdTasks(int argc, char *argv[]);
+static void cmdProf(int argc, char *argv[]);
+
+static int readLine(char *line, unsigned len);
+static int parseSensor(const char *arg);
+static const char *sensorName(int sensor);
+static void updateConfig(int sensor, const sh_SensorConfig_t *pConfig);
+
+// --- Private Data --------------------------------------------------------
+
+static const command_t commands[] = {
+	{ "help",    "",                            cmdHelp },
+	{ "sensors", "",                            cmdSensors },
+	{ "enable",  "<sensor> [interval_us]",      cmdEnable },
+	{ "disable", "<sensor>",                    cmdDisable },
+	{ "rate",    "<sensor> <interval_us>",      cmdRate },
+	{ "sens",    "<sensor> <value> [abs|rel]",  cmdSens },
+	{ "format",  "text|dsf|binary",             cmdFormat },
+	{ "stats",   "",                            cmdStats },
+	{ "baud",    "[rate]",                      cmdBaud },
+	{ "intn",    "",                            cmdIntn },
+	{ "i2c",     "[it|dma]",                    cmdI2c },
+	{ "top",     "",                            cmdTop },
+	{ "mem",     "",                            cmdMem },
+	{ "tasks",   "",                            cmdTasks },
+	{ "prof",    "[clear]",                     cmdProf },
+};
+
+// Sensor names accepted in commands.  Numeric ids work for all sensors.
+static const struct {
+	const char *name;
+	int sensor;
+} sensorNames[] = {
+	{ "rv",     SH_ROTATION_VECTOR },
+	{ "rawacc", SH_RAW_ACCELEROMETER },
+	{ "rawmag", SH_RAW_MAGNETOMETER },
+	{ "rawgyro",SH_RAW_GYROSCOPE },
+	{ "acc",    SH_ACCELEROMETER },
+	{ "mag",    SH_MAGNETIC_FIELD_CALIBRATED },
+};
+
+#define ARRAY_LEN(a) (sizeof(a)/sizeof((a)[0]))
+
+// --- Public API ----------------------------------------------------------
+
+void shellTask(void)
+{
+	char line[SHELL_LINE_LEN];
+	char *argv[SHELL_MAX_ARGS];
+	int argc;
+
+	while (1) {
+		if (readLine(line, sizeof(line)) <= 0) {
+			continue;
+		}
+
+		// Split into words
+		argc = 0;
+		for (char *tok = strtok(line, " \t"); 
+		     (tok != 0) && (argc < SHELL_MAX_ARGS);
+		     tok = strtok(0, " \t")) {
+			argv[argc++] = tok;
+		}
+		if (argc == 0) {
+			continue;
+		}
+
+		// Dispatch
+		bool found = false;
+		for (int n = 0; n < ARRAY_LEN(commands); n++) {
+			if (strcmp(argv[0], commands[n].name) == 0) {
+				commands[n].handler(argc, argv);
+				found = true;
+				break;
+			}
+		}
+		if (!found) {
+			printf("Unknown command: %s (try help)\n", argv[0]);
+		}
+	}
+}
+
+// --- Command handlers ----------------------------------------------------
+
+static void cmdHelp(int argc, char *argv[])
+{
+	printf("Commands:\n");
+	for (int n = 0; n < ARRAY_LEN(commands); n++) {
+		printf("  %s %s\n", commands[n].name, commands[n].usage);
+	}
+	printf("Sensors:");
+	for (int n = 0; n < ARRAY_LEN(sensorNames); n++) {
+		printf(" %s", sensorNames[n].name);
+	}
+	printf(", or a sensor id 0-%d\n", SH_MAX_SENSOR_ID);
+}
+
+static void cmdSensors(int argc, char *argv[])
+{
+	sh_SensorConfig_t config;
+
+	for (int sensor = 0; sensor <= SH_MAX_SENSOR_ID; sensor++) {
+		if ((sensorApp_getConfig(sensor, &config) == 0) &&
+		    (config.reportInterval_us != 0)) {
+			printf("  %d %s: %u us, sensitivity %u %s%s\n",
+			       sensor, sensorName(sensor),
+			       config.reportInterval_us,
+			       config.changeSensitivity,
+			       config.changeSensitivityRelative ? "rel" : "abs",
+			       config.changeSensitivityEnabled ? "" : " (off)");
+		}
+	}
+}
+
+static void cmdEnable(int argc, char *argv[])
+{
+	sh_SensorConfig_t config;
+	int sensor;
+
+	if ((argc < 2) || ((sensor = parseSensor(argv[1])) < 0)) {
+		printf("Usage: enable <sensor> [interval_us]\n");
+		return;
+	}
+
+	sensorApp_getConfig(sensor, &config);
+	config.reportInterval_us = (argc > 2) ? strtoul(argv[2], 0, 0) : 10000;
+	updateConfig(sensor, &config);
+}
+
+static void cmdDisable(int argc, char *argv[])
+{
+	sh_SensorConfig_t config;
+	int sensor;
+
+	if ((argc < 2) || ((sensor = parseSensor(argv[1])) < 0)) {
+		printf("Usage: disable <sensor>\n");
+		return;
+	}
+
+	sensorApp_getConfig(sensor, &config);
+	config.reportInterval_us = 0;
+	updateConfig(sensor, &config);
+}
+
+static void cmdRate(int argc, char *argv[])
+{
+	sh_SensorConfig_t config;
+	int sensor;
+
+	if ((argc < 3) || ((sensor = parseSensor(argv[1])) < 0)) {
+		printf("Usage: rate <sensor> <interval_us>\n");
+		return;
+	}
+
+	sensorApp_getConfig(sensor, &config);
+	config.reportInterval_us = strtoul(argv[2], 0, 0);
+	updateConfig(sensor, &config);
+}
+
+static void cmdSens(int argc, char *argv[])
+{
+	sh_SensorConfig_t config;
+	int sensor;
+
+	if ((argc < 3) || ((sensor = parseSensor(argv[1])) < 0)) {
+		printf("Usage: sens <sensor> <value> [abs|rel]\n");
+		return;
+	}
+
+	sensorApp_getConfig(sensor, &config);
+	config.changeSensitivity = strtoul(argv[2], 0, 0);
+	config.changeSensitivityEnabled = (config.changeSensitivity != 0);
+	if (argc > 3) {
+		config.changeSensitivityRelative = (strcmp(argv[3], "rel") == 0);
+	}
+	updateConfig(sensor, &config);
+}
+
+static void cmdFormat(int argc, char *argv[])
+{
+	if (argc < 2) {
+		printf("Usage: format text|dsf|binary\n");
+	}
+	else if (strcmp(argv[1], "text") == 0) {
+		sensorApp_setOutput(SENSOR_APP_OUTPUT_TEXT);
+	}
+	else if (strcmp(argv[1], "dsf") == 0) {
+		sensorApp_setOutput(SENSOR_APP_OUTPUT_DSF);
+	}
+	else if (strcmp(argv[1], "binary") == 0) {
+		sensorApp_setOutput(SENSOR_APP_OUTPUT_BINARY);
+	}
+	else {
+		printf("Unknown format: %s\n", argv[1]);
+	}
+}
+
+static void cmdStats(int argc, char *argv[])
+{
+	sensorApp_printStats();
+}
+
+// Print the edges logged in compare mode since the last time.
+static void cmdIntn(int argc, char *argv[])
+{
+	bno_intnCaptureStats_t stats;
+	bno_intnCompare_t edge;
+	unsigned count = 0;
+
+	bno_getIntnCaptureStats(&stats);
+	if (stats.mode != BNO_INTN_TS_COMPARE) {
+		printf("INTN compare mode not enabled (INTN_TIMESTAMP).\n");
+		return;
+	}
+
+	printf("Edge       Capture(us)  EXTI(us)     Latency(us)\n");
+	while (bno_popIntnCompare(&edge)) {
+		printf("%-10u %-12u %-12u %u\n", edge.sequence, edge.capture_us,
+		       edge.software_us, edge.software_us - edge.capture_us);
+		count++;
+	}
+	printf("%u edges, %u not logged.\n", count, stats.logDrops);
+}
+
+// Select interrupt or DMA reads, and print what each has cost.
+static void cmdI2c(int argc, char *argv[])
+{
+	bno_i2cCost_t cost[2];
+	bno_i2cRecovery_t recovery;
+
+	if (argc > 1) {
+		if (strcmp(argv[1], "dma") == 0) {
+			bno_setI2cDma(true);
+		}
+		else if (strcmp(argv[1], "it") == 0) {
+			bno_setI2cDma(false);
+		}
+		else {
+			printf("Unknown mode: %s\n", argv[1]);
+			return;
+		}
+	}
+
+	bno_getI2cCost(&cost[0], &cost[1]);
+	printf("I2C reads by %s.\n", bno_getI2cDma() ? "DMA" : "interrupt");
+	for (int n = 0; n < 2; n++) {
+		if (cost[n].transfers == 0) {
+			continue;
+		}
+		// ISRs per read to one decimal place
+		uint32_t isrs10 = (uint32_t)((uint64_t)cost[n].isrs * 10 / cost[n].transfers);
+		printf("  %-4s %u reads, %u bytes: %u.%u ISRs/read, %u cycles/byte\n",
+		       (n == 0) ? "IT" : "DMA", cost[n].transfers, cost[n].bytes,
+		       isrs10 / 10, isrs10 % 10,
+		       (uint32_t)(cost[n].cycles / cost[n].bytes));
+	}
+
+	bno_getI2cRecovery(&recovery);
+	printf("Faults: nack %u, bus %u, arlo %u, ovr %u, dma %u, "
+	       "timeout %u, busy %u, start %u\n",
+	       recovery.faults[BNO_I2C_FAULT_NACK],
+	       recovery.faults[BNO_I2C_FAULT_BUS],
+	       recovery.faults[BNO_I2C_FAULT_ARLO],
+	       recovery.faults[BNO_I2C_FAULT_OVR],
+	       recovery.faults[BNO_I2C_FAULT_DMA],
+	       recovery.faults[BNO_I2C_FAULT_TIMEOUT],
+	       recovery.faults[BNO_I2C_FAULT_BUSY],
+	       recovery.faults[BNO_I2C_FAULT_START]);
+	printf("Recovery: %u retries, %u recovered, %u failed, %u resets, "
+	       "%u bus clears (%u left stuck)\n",
+	       recovery.retries, recovery.recovered, recovery.failed,
+	       recovery.reinits, recovery.busClears, recovery.stuck);
+	if (recovery.recovered != 0) {
+		printf("  recovered in min %u us, mean %u us, max %u us\n",
+		       recovery.minRecover_us,
+		       (uint32_t)(recovery.totalRecover_us / recovery.recovered),
+		       recovery.maxRecover_us);
+	}
+}
+
+static void cmdBaud(int argc, char *argv[])
+{
+	if (argc < 2) {
+		console_printBaudRates();
+		return;
+	}
+
+	console_setBaud(strtoul(argv[1], 0, 0));
+}
+
+// CPU per task and interrupt since the last top.
+static void cmdTop(int argc, char *argv[])
+{
+	cpuStats_printTop();
+}
+
+// Kernel object RAM by module, against each module's budget.
+static void cmdMem(int argc, char *argv[])
+{
+	rtosPool_print();
+}
+
+// Task plan and worst response times since boot.
+static void cmdTasks(int argc, char *argv[])
+{
+	appTasks_print();
+}
+
+// Profiling scopes since boot or the last clear.
+static void cmdProf(int argc, char *argv[])
+{
+	if ((argc > 1) && (strcmp(argv[1], "clear") == 0)) {
+		prof_clear();
+		return;
+	}
+
+	prof_print();
+}
+
+// --- Private functions ---------------------------------------------------
+
+// Read a line with simple backspace handling.  Returns its length.
+static int readLine(char *line, unsigned len)
+{
+	unsigned n = 0;
+
+	while (1) {
+		int c = getchar();
+		if (c == '\n') {
+			break;
+		}
+		if ((c == '\b') || (c == 0x7F)) {
+			if (n > 0) {
+				n--;
+			}
+			continue;
+		}
+		if (n < len - 1) {
+			line[n++] = c;
+		}
+	}
+	line[n] = 0;
+
+	return n;
+}
+
+// Sensor id from a name or number, -1 if not valid.
+static int parseSensor(const char *arg)
+{
+	char *end;
+	
+	for (int n = 0; n < ARRAY_LEN(sensorNames); n++) {
+		if (strcmp(arg, sensorNames[n].name) == 0) {
+			return sensorNames[n].sensor;
+		}
+	}
+
+	long sensor = strtol(arg, &end, 0);
+	if ((*end != 0) || (sensor < 0) || (sensor > SH_MAX_SENSOR_ID)) {
+		printf("Unknown sensor: %s\n", arg);
+		return -1;
+	}
+
+	return sensor;
+}
+
+static const char *sensorName(int sensor)
+{
+	for (int n = 0; n < ARRAY_LEN(sensorNames); n++) {
+		if (sensorNames[n].sensor == sensor) {
+			return sensorNames[n].name;
+		}
+	}
+
+	return "";
+}
+
+static void updateConfig(int sensor, const sh_SensorConfig_t *pConfig)
+{
+	if (sensorApp_setConfig(sensor, pConfig) != 0) {
+		printf("Busy, try again.\n");
+	}
+}
@@ -0,0 +1,174 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "timebase.h"
+
+// Interrupt half way round as well as at the wrap, so the epoch is never
+// more than half a wrap old even if an interrupt is late.
+#define HALF_WRAP (0x80000000)
+
+// --- Type Definitions ---------------------------------------------------
+
+typedef struct epoch_s {
+	uint64_t base_us;
+	uint32_t base_cnt;
+} epoch_t;
+
+// --- Private Data --------------------------------------------------------
+
+static TIM_HandleTypeDef *htim;
+static uint32_t tickHz;
+
+// Epoch in two copies.  Readers use epoch[seq & 1], which the IRQ handler
+// never writes while seq selects it; a reader that sees seq change simply
+// retries.  base_us and base_cnt agree in their low 32 bits, so
+// timebase_now32 is the counter itself.
+static epoch_t epoch[2];
+static volatile uint32_t seq;
+
+// HAL tick count when the timer started, and the time then
+static uint32_t startTick_ms;
+static uint64_t start_us;
+
+// --- Forward Declarations ------------------------------------------------
+
+static uint32_t timerClock(void);
+
+// --- Public API ----------------------------------------------------------
+
+void timebase_init(TIM_HandleTypeDef *_htim)
+{
+	uint32_t clock = timerClock();
+	uint32_t prescaler = (clock + TIMEBASE_HZ/2) / TIMEBASE_HZ - 1;
+
+	htim = _htim;
+	tickHz = clock / (prescaler + 1);
+
+	if (htim->Instance->PSC != prescaler) {
+		__HAL_TIM_SET_PRESCALER(htim, prescaler);
+		// Load it now instead of at the next wrap
+		htim->Instance->EGR = TIM_EGR_UG;
+	}
+
+	uint32_t cnt = __HAL_TIM_GET_COUNTER(htim);
+	startTick_ms = HAL_GetTick();
+	start_us = cnt;
+	seq = 0;
+	for (int n = 0; n < 2; n++) {
+		epoch[n].base_us = cnt;
+		epoch[n].base_cnt = cnt;
+	}
+
+	__HAL_TIM_SET_COMPARE(htim, TIM_CHANNEL_1, HALF_WRAP);
+	__HAL_TIM_CLEAR_FLAG(htim, TIM_FLAG_UPDATE | TIM_FLAG_CC1);
+	__HAL_TIM_ENABLE_IT(htim, TIM_IT_UPDATE | TIM_IT_CC1);
+
+	HAL_TIM_Base_Start(htim);
+}
+
+void timebase_irqHandler(void)
+{
+	// TIM2's other channels may share the interrupt
+	if ((htim->Instance->SR & (TIM_FLAG_UPDATE | TIM_FLAG_CC1)) == 0) {
+		return;
+	}
+	__HAL_TIM_CLEAR_FLAG(htim, TIM_FLAG_UPDATE | TIM_FLAG_CC1);
+
+	// Advance from the epoch readers are using now
+	const epoch_t *pCur = &epoch[seq & 1];
+	uint32_t cnt = __HAL_TIM_GET_COUNTER(htim);
+	uint64_t now_us = pCur->base_us + (uint32_t)(cnt - pCur->base_cnt);
+
+	// Readers move to epoch[1] while epoch[0] is written, then back.
+	seq++;
+	__DMB();
+	epoch[0].base_us = now_us;
+	epoch[0].base_cnt = cnt;
+	__DMB();
+	seq++;
+	__DMB();
+	epoch[1].base_us = now_us;
+	epoch[1].base_cnt = cnt;
+}
+
+uint64_t timebase_now_us(void)
+{
+	uint32_t s, cnt;
+	uint64_t base_us;
+	uint32_t base_cnt;
+
+	do {
+		s = seq;
+		__DMB();
+		base_us = epoch[s & 1].base_us;
+		base_cnt = epoch[s & 1].base_cnt;
+		cnt = __HAL_TIM_GET_COUNTER(htim);
+		__DMB();
+	} while (s != seq);
+
+	return base_us + (uint32_t)(cnt - base_cnt);
+}
+
+uint32_t timebase_now32(void)
+{
+	return __HAL_TIM_GET_COUNTER(htim);
+}
+
+uint64_t timebase_extend(uint32_t t_us)
+{
+	uint64_t now_us = timebase_now_us();
+
+	return now_us - (uint32_t)((uint32_t)now_us - t_us);
+}
+
+uint64_t timebase_sinceMain_us(void)
+{
+	return (uint64_t)startTick_ms * 1000 + (timebase_now_us() - start_us);
+}
+
+uint32_t timebase_ticksFor(uint32_t wait_us, uint32_t tickHz)
+{
+	return (uint32_t)(((uint64_t)wait_us * tickHz + TIMEBASE_HZ - 1) / TIMEBASE_HZ);
+}
+
+uint32_t timebase_ticksToMs(uint32_t ticks, uint32_t tickHz)
+{
+	return (uint32_t)((uint64_t)ticks * 1000 / tickHz);
+}
+
+uint32_t timebase_tickHz(void)
+{
+	return tickHz;
+}
+
+// --- Private functions ---------------------------------------------------
+
+// Input clock of the APB1 timers (TIM2-5): PCLK1, doubled whenever APB1
+// is divided down from HCLK.
+static uint32_t timerClock(void)
+{
+	RCC_ClkInitTypeDef clkConfig;
+	uint32_t flashLatency;
+
+	HAL_RCC_GetClockConfig(&clkConfig, &flashLatency);
+	if (clkConfig.APB1CLKDivider == RCC_HCLK_DIV1) {
+		return HAL_RCC_GetPCLK1Freq();
+	}
+
+	return 2 * HAL_RCC_GetPCLK1Freq();
+}
@@ -0,0 +1,68 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+// Monotonic 1us timebase for event timestamps.
+//
+// A 32-bit timer runs at 1 MHz, with its prescaler computed from the
+// clock tree at init.  The timer interrupts twice per wrap to move a
+// 64-bit epoch forward.  Readers never block, so they may run in any task
+// or ISR, including ones that preempt the timer interrupt.
+
+#include <stdint.h>
+
+#include "stm32f4xx_hal.h"
+
+// Tick rate the prescaler is chosen for
+#define TIMEBASE_HZ (1000000)
+
+// Set the prescaler for 1us ticks, enable the wrap interrupts and start
+// the timer.  Time continues from the timer's current count.
+void timebase_init(TIM_HandleTypeDef *htim);
+
+// Call from the timer's IRQ handler.
+void timebase_irqHandler(void);
+
+// Microseconds since the timer started.
+uint64_t timebase_now_us(void);
+
+// Low 32 bits of timebase_now_us (a single counter read).
+uint32_t timebase_now32(void);
+
+// Extend a 32-bit timestamp, taken in the last 2^32 us, to 64 bits.
+uint64_t timebase_extend(uint32_t t_us);
+
+// Microseconds since main() started.  HAL_Init, first thing in main(),
+// starts the HAL tick, so this is the tick count at timebase_init (to the
+// ms) plus the timer since.
+uint64_t timebase_sinceMain_us(void);
+
+// RTOS ticks at tickHz covering wait_us, rounded up.  (Blocking for that
+// many can still return up to a tick early: the first is partly gone.)
+uint32_t timebase_ticksFor(uint32_t wait_us, uint32_t tickHz);
+
+// RTOS ticks at tickHz in ms, rounded down.  (Unlike portTICK_PERIOD_MS,
+// right at any tick rate.)
+uint32_t timebase_ticksToMs(uint32_t ticks, uint32_t tickHz);
+
+// Actual tick rate, timer input clock divided by the prescaler.
+uint32_t timebase_tickHz(void);
+
+#endif
@@ -0,0 +1,132 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+// POSIX stand-in for the subset of FreeRTOS used by the sensor app, for the
+// Linux simulation build.  Tasks are pthreads; semaphores, mutexes and
+// queues are all one queue type, as in FreeRTOS itself.  Priorities are
+// recorded but not enforced by the host scheduler.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+typedef struct hostQueue_s *QueueHandle_t;
+typedef QueueHandle_t SemaphoreHandle_t;
+typedef struct hostTask_s *TaskHandle_t;
+typedef TaskHandle_t xTaskHandle;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE  ((BaseType_t)1)
+#define pdPASS  (pdTRUE)
+#define pdFAIL  (pdFALSE)
+
+// Any rate dividing 1000 (build with -DconfigTICK_RATE_HZ=100 to check
+// the app at another)
+#ifndef configTICK_RATE_HZ
+#define configTICK_RATE_HZ  ((TickType_t)1000)
+#endif
+#define configMINIMAL_STACK_SIZE ((uint16_t)128)
+#define configTOTAL_HEAP_SIZE    ((size_t)15360)
+#define portTICK_PERIOD_MS  ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFF)
+
+#define configASSERT(x) assert(x)
+
+#define portYIELD_FROM_ISR(x)   ((void)(x))
+#define portEND_SWITCHING_ISR(x) ((void)(x))
+
+// Queues
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t q, const void *pItem, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t q, void *pItem, TickType_t wait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q);
+
+// Semaphores and mutexes
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+#define xSemaphoreTake(s, wait) xQueueReceive((s), 0, (wait))
+#define xSemaphoreGive(s) xQueueSend((s), 0, 0)
+#define xSemaphoreGiveFromISR(s, pWoken) \
+	(*(pWoken) = pdFALSE, xQueueSend((s), 0, 0))
+
+// Host only: take with a timeout in us rather than ticks, standing in for
+// the board's TIM2 compare wakeup.
+BaseType_t host_semaphoreTakeUs(SemaphoreHandle_t s, uint32_t wait_us);
+
+// Heap.  The host counts its own queues and task stacks against
+// configTOTAL_HEAP_SIZE; they are not the target's sizes.
+size_t xPortGetFreeHeapSize(void);
+size_t xPortGetMinimumEverFreeHeapSize(void);
+
+// Tasks
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name,
+                       uint16_t stackDepth, void *params,
+                       UBaseType_t prio, TaskHandle_t *pHandle);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+
+// Task numbers are kept, but the host scheduler has no trace hooks, so
+// the task table's response times stay empty.  Critical sections exclude
+// each other only: there are no interrupts to mask.
+void vTaskSetTaskNumber(TaskHandle_t task, UBaseType_t number);
+void vPortEnterCritical(void);
+void vPortExitCritical(void);
+#define taskENTER_CRITICAL() vPortEnterCritical()
+#define taskEXIT_CRITICAL()  vPortExitCritical()
+
+// Task states and the snapshot behind the console's top view.  Run time
+// is the thread's CPU time in us; stack high water is not tracked (0).
+// State is Running for the caller, else Ready or Blocked as the host
+// scheduler has the thread.
+typedef enum {
+	eRunning = 0,
+	eReady,
+	eBlocked,
+	eSuspended,
+	eDeleted
+} eTaskState;
+
+typedef struct xTASK_STATUS {
+	TaskHandle_t xHandle;
+	const char *pcTaskName;
+	UBaseType_t xTaskNumber;
+	eTaskState eCurrentState;
+	UBaseType_t uxCurrentPriority;
+	UBaseType_t uxBasePriority;
+	uint32_t ulRunTimeCounter;
+	uint16_t usStackHighWaterMark;
+} TaskStatus_t;
+
+UBaseType_t uxTaskGetNumberOfTasks(void);
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *pStatus, UBaseType_t max,
+                                 uint32_t *pTotalRunTime);
+
+// Host only: CPU time used so far by each task created, for benchmarking.
+// Fills up to max entries, returns the number of tasks.
+unsigned host_getTaskTimes(const char **pNames, uint64_t *pCpu_us,
+                           unsigned max);
+
+#endif
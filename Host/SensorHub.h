@@ -0,0 +1,123 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef HOST_SENSORHUB_H
+#define HOST_SENSORHUB_H
+
+// Stand-in for the SH-1 driver API (SensorHub.h from the sh1-mcu-driver
+// submodule), declaring just what the sensor app and shell use.  It is
+// implemented over the shdev_* interface by sh_sim_hub.c, talking to the
+// simulated hub in sh_sim_dev.c.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SH1_DRIVER_VERSION "host-sim"
+
+#define MAX_SH_UNITS (2)
+#define SH_NUM_PRODUCT_IDS (4)
+#define SH_MAX_SENSOR_ID (0x2F)
+
+// shdev_waitIntn timeout meaning "no timeout"
+#define SH_WAIT_FOREVER (0xFFFF)
+
+typedef int sh_Status_t;
+
+#define SH_STATUS_SUCCESS        (0)
+#define SH_STATUS_ERROR          (-1)
+#define SH_STATUS_BAD_PARAM      (-2)
+#define SH_STATUS_TIMEOUT        (-3)
+#define SH_STATUS_ERROR_I2C_IO   (-4)
+#define SH_STATUS_NO_EVENT       (-5)
+#define SH_STATUS_INVALID_HCBIN  (-6)
+
+typedef enum {
+	SH_ACCELEROMETER = 0x01,
+	SH_MAGNETIC_FIELD_CALIBRATED = 0x03,
+	SH_ROTATION_VECTOR = 0x05,
+	SH_RAW_ACCELEROMETER = 0x14,
+	SH_RAW_GYROSCOPE = 0x15,
+	SH_RAW_MAGNETOMETER = 0x16,
+} sh_SensorId_t;
+
+typedef struct sh_ProductId_s {
+	uint32_t swPartNumber;
+	uint8_t swVersionMajor;
+	uint8_t swVersionMinor;
+	uint16_t swVersionPatch;
+	uint32_t swBuildNumber;
+} sh_ProductId_t;
+
+typedef struct sh_SensorConfig_s {
+	bool changeSensitivityEnabled;
+	bool wakeupEnabled;
+	bool changeSensitivityRelative;
+	uint16_t changeSensitivity;
+	uint32_t reportInterval_us;
+	uint32_t reserved1;
+} sh_SensorConfig_t;
+
+typedef struct sh_Raw_s {
+	int16_t x;
+	int16_t y;
+	int16_t z;
+} sh_Raw_t;
+
+typedef struct sh_SensorEvent_s {
+	uint32_t time_us;
+	uint8_t sensor;
+	uint8_t sequenceNumber;
+	uint8_t status;
+	uint8_t delay;
+	union {
+		sh_Raw_t rawAccelerometer;
+		sh_Raw_t rawMagnetometer;
+		sh_Raw_t rawGyroscope;
+		struct {
+			int16_t x_16Q8;
+			int16_t y_16Q8;
+			int16_t z_16Q8;
+		} accelerometer;
+		struct {
+			int16_t x_16Q4;
+			int16_t y_16Q4;
+			int16_t z_16Q4;
+		} magneticField;
+		struct {
+			int16_t real_16Q14;
+			int16_t i_16Q14;
+			int16_t j_16Q14;
+			int16_t k_16Q14;
+			int16_t accuracy_16Q12;
+		} rotationVector;
+	} un;
+} sh_SensorEvent_t;
+
+// Reset the hub and return a handle to it, or 0.
+void *sh_init(int unit);
+
+// Wait for the hub's next report.  Returns SH_STATUS_SUCCESS with *pEvent
+// filled in, or SH_STATUS_TIMEOUT if none arrived in time.
+int sh_getEvent(void *pSensorHub, sh_SensorEvent_t *pEvent);
+
+int sh_getProdIds(void *pSensorHub, sh_ProductId_t *pProdIds);
+
+int sh_setSensorConfig(void *pSensorHub, sh_SensorId_t sensor,
+                       const sh_SensorConfig_t *pConfig);
+
+#endif
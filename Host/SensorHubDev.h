@@ -0,0 +1,41 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef HOST_SENSORHUBDEV_H
+#define HOST_SENSORHUBDEV_H
+
+// Platform interface the SH-1 driver runs on.  Stand-in for SensorHubDev.h
+// from the sh1-mcu-driver submodule; the board implements it in
+// Hillcrest/sh_bno_stm32f401.c, the simulation in sh_sim_dev.c.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "SensorHub.h"
+
+void * shdev_init(int unit);
+sh_Status_t shdev_reset(void * dev);
+sh_Status_t shdev_reset_dfu(void * dev);
+sh_Status_t shdev_i2c(void *pDev,
+                      const uint8_t *pSend, unsigned sendLen,
+                      uint8_t *pReceive, unsigned receiveLen);
+bool shdev_getIntn(void *dev);
+bool shdev_waitIntn(void *dev, uint16_t wait_ms);
+uint32_t shdev_getTimestamp_us(void *dev);
+
+#endif
@@ -0,0 +1,363 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+// Simulated USART2 with DMA transmit, TIM2 and the DWT cycle counter, for
+// the Linux simulation build.
+
+#define _GNU_SOURCE
+#include "stm32f4xx_hal.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#define PCLK1_HZ (42000000)
+
+// APB1 timer clock, MHz (twice PCLK1, since APB1 is divided)
+#define TIMCLK_MHZ (2 * PCLK1_HZ / 1000000)
+
+// Bits per character: start, 8 data, stop
+#define UART_BITS_PER_CHAR (10)
+
+// --- Private data --------------------------------------------------------
+
+USART_TypeDef host_usart2;
+TIM_TypeDef host_tim2;
+CoreDebug_Type host_coreDebug;
+
+// The cycle counter counts ns
+uint32_t SystemCoreClock = 1000000000;
+static __thread DWT_Type dwt;
+
+// IRQ locks.  Recursive, so an ISR may call code that masks its own IRQ.
+static pthread_mutex_t usart2Irq = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static pthread_mutex_t tim2Irq = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+// Transfer requests from the console to the UART threads
+static pthread_mutex_t uartLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t uartChanged = PTHREAD_COND_INITIALIZER;
+static UART_HandleTypeDef *uart;
+static const uint8_t *txData;
+static uint16_t txSize;
+static uint8_t *rxData;
+static int txFd = -1;
+static int rxFd = -1;
+
+// TIM2 counts timBase + ticks since timStart_ns while running
+static pthread_mutex_t timLock = PTHREAD_MUTEX_INITIALIZER;
+static bool timRunning;
+static uint64_t timBase;
+static uint64_t timStart_ns;
+
+// HAL tick: ms since HAL_Init
+static uint64_t halInit_ns;
+
+// --- Forward Declarations ------------------------------------------------
+
+static pthread_mutex_t *irqLock(IRQn_Type irq);
+static void *txThread(void *arg);
+static void *rxThread(void *arg);
+static void *timThread(void *arg);
+static uint64_t timTicks(void);
+static uint64_t monotonic_ns(void);
+
+// --- Public API ----------------------------------------------------------
+
+HAL_StatusTypeDef HAL_Init(void)
+{
+	halInit_ns = monotonic_ns();
+
+	return HAL_OK;
+}
+
+DWT_Type *host_dwt(void)
+{
+	dwt.CYCCNT = (uint32_t)monotonic_ns();
+
+	return &dwt;
+}
+
+uint32_t HAL_GetTick(void)
+{
+	return (uint32_t)((monotonic_ns() - halInit_ns) / 1000000);
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+	return PCLK1_HZ;
+}
+
+void HAL_RCC_GetClockConfig(RCC_ClkInitTypeDef *pClkInit, uint32_t *pFLatency)
+{
+	pClkInit->APB1CLKDivider = RCC_HCLK_DIV2;
+	*pFLatency = 2;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim)
+{
+	pthread_t thread;
+
+	pthread_mutex_lock(&timLock);
+	if (timRunning) {
+		pthread_mutex_unlock(&timLock);
+		return HAL_OK;
+	}
+	timStart_ns = monotonic_ns();
+	timRunning = true;
+	pthread_mutex_unlock(&timLock);
+
+	pthread_create(&thread, 0, timThread, 0);
+	pthread_detach(thread);
+
+	return HAL_OK;
+}
+
+uint32_t host_timGetCounter(TIM_HandleTypeDef *htim)
+{
+	return (uint32_t)host_timCount64();
+}
+
+void host_timSetCounter(TIM_HandleTypeDef *htim, uint32_t count)
+{
+	pthread_mutex_lock(&timLock);
+	timBase = count;
+	timStart_ns = monotonic_ns();
+	pthread_mutex_unlock(&timLock);
+}
+
+uint64_t host_timCount64(void)
+{
+	uint64_t count;
+
+	pthread_mutex_lock(&timLock);
+	count = timTicks();
+	pthread_mutex_unlock(&timLock);
+
+	return count;
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type irq)
+{
+	pthread_mutex_lock(irqLock(irq));
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type irq)
+{
+	pthread_mutex_unlock(irqLock(irq));
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart,
+                                        uint8_t *pData, uint16_t size)
+{
+	HAL_StatusTypeDef rc = HAL_OK;
+
+	pthread_mutex_lock(&uartLock);
+	if (txSize != 0) {
+		rc = HAL_BUSY;
+	}
+	else {
+		txData = pData;
+		txSize = size;
+		huart->Instance->SR &= ~USART_SR_TC;
+		pthread_cond_broadcast(&uartChanged);
+	}
+	pthread_mutex_unlock(&uartLock);
+
+	return rc;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart,
+                                      uint8_t *pData, uint16_t size)
+{
+	pthread_mutex_lock(&uartLock);
+	rxData = pData;
+	pthread_cond_broadcast(&uartChanged);
+	pthread_mutex_unlock(&uartLock);
+
+	return HAL_OK;
+}
+
+void host_uartStart(UART_HandleTypeDef *huart, int outFd, int inFd)
+{
+	pthread_t thread;
+
+	uart = huart;
+	txFd = outFd;
+	rxFd = inFd;
+
+	huart->Instance->SR = USART_SR_TC;
+	huart->Instance->BRR = UART_BRR_SAMPLING16(PCLK1_HZ, huart->Init.BaudRate);
+	huart->Instance->CR1 = USART_CR1_UE;
+
+	pthread_create(&thread, 0, txThread, 0);
+	pthread_detach(thread);
+	if (rxFd >= 0) {
+		pthread_create(&thread, 0, rxThread, 0);
+		pthread_detach(thread);
+	}
+}
+
+// --- Private functions ---------------------------------------------------
+
+static pthread_mutex_t *irqLock(IRQn_Type irq)
+{
+	return (irq == TIM2_IRQn) ? &tim2Irq : &usart2Irq;
+}
+
+// DMA transmit: hold each transfer for as long as the wire would take at
+// the programmed baud rate, then raise the completion interrupt.
+static void *txThread(void *arg)
+{
+	struct timespec due;
+
+	clock_gettime(CLOCK_MONOTONIC, &due);
+	while (1) {
+		pthread_mutex_lock(&uartLock);
+		while (txSize == 0) {
+			pthread_cond_wait(&uartChanged, &uartLock);
+		}
+		const uint8_t *pData = txData;
+		uint16_t size = txSize;
+		pthread_mutex_unlock(&uartLock);
+
+		// With 16x oversampling, baud = pclk / BRR.  Transfers queued while
+		// the line is busy start where the last one ended.
+		uint64_t ns = (uint64_t)size * UART_BITS_PER_CHAR *
+			uart->Instance->BRR * 1000000000ULL / PCLK1_HZ;
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if ((due.tv_sec < now.tv_sec) ||
+		    ((due.tv_sec == now.tv_sec) && (due.tv_nsec < now.tv_nsec))) {
+			due = now;
+		}
+		ns += due.tv_nsec;
+		due.tv_sec += ns / 1000000000ULL;
+		due.tv_nsec = ns % 1000000000ULL;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, 0) != 0) {
+			// interrupted, keep waiting
+		}
+
+		if (txFd >= 0) {
+			size_t done = 0;
+			while (done < size) {
+				ssize_t n = write(txFd, pData + done, size - done);
+				if (n <= 0) {
+					break;
+				}
+				done += n;
+			}
+		}
+
+		// Transfer complete interrupt
+		pthread_mutex_lock(&usart2Irq);
+		pthread_mutex_lock(&uartLock);
+		txSize = 0;
+		uart->Instance->SR |= USART_SR_TC;
+		pthread_mutex_unlock(&uartLock);
+		HAL_UART_TxCpltCallback(uart);
+		pthread_mutex_unlock(&usart2Irq);
+	}
+
+	return 0;
+}
+
+// Receive: one byte per armed HAL_UART_Receive_IT, like the target.
+static void *rxThread(void *arg)
+{
+	uint8_t c;
+
+	while (read(rxFd, &c, 1) == 1) {
+		pthread_mutex_lock(&uartLock);
+		while (rxData == 0) {
+			pthread_cond_wait(&uartChanged, &uartLock);
+		}
+		uint8_t *pDest = rxData;
+		rxData = 0;
+		pthread_mutex_unlock(&uartLock);
+
+		*pDest = c;
+
+		// Receive complete interrupt
+		pthread_mutex_lock(&usart2Irq);
+		HAL_UART_RxCpltCallback(uart);
+		pthread_mutex_unlock(&usart2Irq);
+	}
+
+	return 0;
+}
+
+// TIM2 interrupts: update at each wrap, CC1 when the count passes CCR1.
+static void *timThread(void *arg)
+{
+	struct timespec due;
+
+	while (1) {
+		pthread_mutex_lock(&timLock);
+		uint64_t now = timTicks();
+		uint64_t wrap = (now | 0xFFFFFFFFULL) + 1;
+		uint64_t compare = (now & ~0xFFFFFFFFULL) | TIM2->CCR1;
+		if (compare <= now) {
+			compare += 0x100000000ULL;
+		}
+		uint64_t next = (compare < wrap) ? compare : wrap;
+		uint64_t at_ns = timStart_ns +
+			(next - timBase) * (TIM2->PSC + 1) * 1000 / TIMCLK_MHZ;
+		pthread_mutex_unlock(&timLock);
+
+		due.tv_sec = at_ns / 1000000000ULL;
+		due.tv_nsec = at_ns % 1000000000ULL;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, 0) != 0) {
+			// interrupted, keep waiting
+		}
+		if (host_timCount64() < next) {
+			// Counter was reloaded meanwhile, start over
+			continue;
+		}
+
+		__sync_fetch_and_or(&TIM2->SR, (next == wrap) ? TIM_FLAG_UPDATE : TIM_FLAG_CC1);
+		if ((TIM2->SR & TIM2->DIER) != 0) {
+			pthread_mutex_lock(&tim2Irq);
+			TIM2_IRQHandler();
+			pthread_mutex_unlock(&tim2Irq);
+		}
+	}
+
+	return 0;
+}
+
+// Count of TIM2 now.  Call holding timLock.
+static uint64_t timTicks(void)
+{
+	if (!timRunning) {
+		return timBase;
+	}
+
+	return timBase + (monotonic_ns() - timStart_ns) * TIMCLK_MHZ /
+		((TIM2->PSC + 1) * 1000);
+}
+
+static uint64_t monotonic_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
@@ -0,0 +1,448 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+// POSIX implementation of the FreeRTOS subset in FreeRTOS.h
+
+#define _GNU_SOURCE
+#include "FreeRTOS.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// Tasks tracked for host_getTaskTimes and uxTaskGetSystemState
+#define HOST_MAX_TASKS (8)
+
+// --- Type Definitions ---------------------------------------------------
+
+struct hostQueue_s {
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	unsigned len;
+	unsigned itemSize;
+	unsigned count;
+	unsigned head;
+	uint8_t *storage;
+};
+
+struct hostTask_s {
+	pthread_t thread;
+	TaskFunction_t fn;
+	void *params;
+	const char *name;
+	UBaseType_t prio;
+	UBaseType_t number;
+	volatile pid_t tid;     // set by the thread as it starts
+};
+
+// --- Private Data --------------------------------------------------------
+
+static pthread_mutex_t tasksLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t criticalLock = PTHREAD_MUTEX_INITIALIZER;
+static TaskHandle_t tasks[HOST_MAX_TASKS];
+static unsigned numTasks;
+
+// Bytes taken by queues and task stacks
+static size_t heapUsed;
+
+// --- Forward Declarations ------------------------------------------------
+
+static bool waitChanged(QueueHandle_t q, TickType_t wait,
+                        const struct timespec *pDeadline);
+static void deadlineAfter(struct timespec *pDeadline, TickType_t ticks);
+static void heapTake(size_t bytes);
+static uint64_t taskCpu_us(TaskHandle_t task);
+static eTaskState taskState(TaskHandle_t task);
+static void *taskEntry(void *arg);
+
+// --- Public API ----------------------------------------------------------
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t itemSize)
+{
+	pthread_condattr_t attr;
+	QueueHandle_t q = calloc(1, sizeof(*q));
+	if (q == 0) {
+		return 0;
+	}
+
+	pthread_mutex_init(&q->lock, 0);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&q->changed, &attr);
+	pthread_condattr_destroy(&attr);
+
+	q->len = len;
+	q->itemSize = itemSize;
+	if (itemSize != 0) {
+		q->storage = malloc(len * itemSize);
+	}
+	heapTake(sizeof(*q) + len * itemSize);
+
+	return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *pItem, TickType_t wait)
+{
+	struct timespec deadline;
+
+	deadlineAfter(&deadline, wait);
+	pthread_mutex_lock(&q->lock);
+	while (q->count == q->len) {
+		if (!waitChanged(q, wait, &deadline)) {
+			pthread_mutex_unlock(&q->lock);
+			return pdFAIL;
+		}
+	}
+
+	if (q->itemSize != 0) {
+		unsigned tail = (q->head + q->count) % q->len;
+		memcpy(&q->storage[tail * q->itemSize], pItem, q->itemSize);
+	}
+	q->count++;
+
+	pthread_cond_broadcast(&q->changed);
+	pthread_mutex_unlock(&q->lock);
+
+	return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *pItem, TickType_t wait)
+{
+	struct timespec deadline;
+
+	deadlineAfter(&deadline, wait);
+	pthread_mutex_lock(&q->lock);
+	while (q->count == 0) {
+		if (!waitChanged(q, wait, &deadline)) {
+			pthread_mutex_unlock(&q->lock);
+			return pdFAIL;
+		}
+	}
+
+	if (q->itemSize != 0) {
+		memcpy(pItem, &q->storage[q->head * q->itemSize], q->itemSize);
+	}
+	q->head = (q->head + 1) % q->len;
+	q->count--;
+
+	pthread_cond_broadcast(&q->changed);
+	pthread_mutex_unlock(&q->lock);
+
+	return pdPASS;
+}
+
+BaseType_t host_semaphoreTakeUs(SemaphoreHandle_t s, uint32_t wait_us)
+{
+	struct timespec deadline;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	uint64_t ns = (uint64_t)wait_us * 1000 + deadline.tv_nsec;
+	deadline.tv_sec += ns / 1000000000UL;
+	deadline.tv_nsec = ns % 1000000000UL;
+
+	pthread_mutex_lock(&s->lock);
+	while (s->count == 0) {
+		if (pthread_cond_timedwait(&s->changed, &s->lock, &deadline) != 0) {
+			pthread_mutex_unlock(&s->lock);
+			return pdFAIL;
+		}
+	}
+	s->head = (s->head + 1) % s->len;
+	s->count--;
+
+	pthread_cond_broadcast(&s->changed);
+	pthread_mutex_unlock(&s->lock);
+
+	return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+	UBaseType_t count;
+
+	pthread_mutex_lock(&q->lock);
+	count = q->count;
+	pthread_mutex_unlock(&q->lock);
+
+	return count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+	// Created empty, like FreeRTOS
+	return xQueueCreate(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+	// Created available.  (No priority inheritance on the host.)
+	SemaphoreHandle_t s = xQueueCreate(1, 0);
+	xSemaphoreGive(s);
+
+	return s;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name,
+                       uint16_t stackDepth, void *params,
+                       UBaseType_t prio, TaskHandle_t *pHandle)
+{
+	TaskHandle_t task = calloc(1, sizeof(*task));
+	if (task == 0) {
+		return pdFAIL;
+	}
+
+	task->fn = fn;
+	task->params = params;
+	task->name = name;
+	task->prio = prio;
+	if (pthread_create(&task->thread, 0, taskEntry, task) != 0) {
+		free(task);
+		return pdFAIL;
+	}
+	pthread_detach(task->thread);
+
+	pthread_mutex_lock(&tasksLock);
+	if (numTasks < HOST_MAX_TASKS) {
+		tasks[numTasks++] = task;
+	}
+	pthread_mutex_unlock(&tasksLock);
+	heapTake(sizeof(*task) + stackDepth * sizeof(uint32_t));
+
+	if (pHandle != 0) {
+		*pHandle = task;
+	}
+
+	return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+	struct timespec deadline;
+
+	if (ticks == 0) {
+		return;
+	}
+
+	deadlineAfter(&deadline, ticks);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, 0) != 0) {
+		// interrupted, sleep again
+	}
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (TickType_t)(now.tv_sec * configTICK_RATE_HZ +
+	                    now.tv_nsec / (1000000000L / configTICK_RATE_HZ));
+}
+
+void vTaskSetTaskNumber(TaskHandle_t task, UBaseType_t number)
+{
+	task->number = number;
+}
+
+void vPortEnterCritical(void)
+{
+	pthread_mutex_lock(&criticalLock);
+}
+
+void vPortExitCritical(void)
+{
+	pthread_mutex_unlock(&criticalLock);
+}
+
+size_t xPortGetFreeHeapSize(void)
+{
+	size_t used;
+
+	pthread_mutex_lock(&tasksLock);
+	used = heapUsed;
+	pthread_mutex_unlock(&tasksLock);
+
+	return (used < configTOTAL_HEAP_SIZE) ? configTOTAL_HEAP_SIZE - used : 0;
+}
+
+size_t xPortGetMinimumEverFreeHeapSize(void)
+{
+	// Nothing is freed
+	return xPortGetFreeHeapSize();
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void)
+{
+	UBaseType_t count;
+
+	pthread_mutex_lock(&tasksLock);
+	count = numTasks;
+	pthread_mutex_unlock(&tasksLock);
+
+	return count;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *pStatus, UBaseType_t max,
+                                 uint32_t *pTotalRunTime)
+{
+	UBaseType_t count;
+	struct timespec now;
+
+	pthread_mutex_lock(&tasksLock);
+	count = numTasks;
+	if (count > max) {
+		// As FreeRTOS: all or nothing
+		pthread_mutex_unlock(&tasksLock);
+		return 0;
+	}
+	for (unsigned n = 0; n < count; n++) {
+		TaskHandle_t task = tasks[n];
+		TaskStatus_t *p = &pStatus[n];
+
+		p->xHandle = task;
+		p->pcTaskName = task->name;
+		p->xTaskNumber = n;
+		p->eCurrentState = taskState(task);
+		p->uxCurrentPriority = task->prio;
+		p->uxBasePriority = task->prio;
+		p->ulRunTimeCounter = (uint32_t)taskCpu_us(task);
+		p->usStackHighWaterMark = 0;
+	}
+	pthread_mutex_unlock(&tasksLock);
+
+	if (pTotalRunTime != 0) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		*pTotalRunTime = (uint32_t)(now.tv_sec * 1000000 + now.tv_nsec / 1000);
+	}
+
+	return count;
+}
+
+unsigned host_getTaskTimes(const char **pNames, uint64_t *pCpu_us,
+                           unsigned max)
+{
+	unsigned count;
+
+	pthread_mutex_lock(&tasksLock);
+	count = numTasks;
+	for (unsigned n = 0; (n < count) && (n < max); n++) {
+		pNames[n] = tasks[n]->name;
+		pCpu_us[n] = taskCpu_us(tasks[n]);
+	}
+	pthread_mutex_unlock(&tasksLock);
+
+	return count;
+}
+
+// --- Private functions ---------------------------------------------------
+
+// Wait for the queue to change.  Returns false on timeout.
+static bool waitChanged(QueueHandle_t q, TickType_t wait,
+                        const struct timespec *pDeadline)
+{
+	if (wait == 0) {
+		return false;
+	}
+	if (wait == portMAX_DELAY) {
+		pthread_cond_wait(&q->changed, &q->lock);
+		return true;
+	}
+
+	return (pthread_cond_timedwait(&q->changed, &q->lock, pDeadline) == 0);
+}
+
+// As in FreeRTOS, a wait of n ticks ends when the tick count has gone up
+// by n: on a tick, with only part of the first one waited.
+static void deadlineAfter(struct timespec *pDeadline, TickType_t ticks)
+{
+	const uint64_t tick_ns = 1000000000UL / configTICK_RATE_HZ;
+
+	if ((ticks == 0) || (ticks == portMAX_DELAY)) {
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, pDeadline);
+	uint64_t now_ns = (uint64_t)pDeadline->tv_sec * 1000000000UL + pDeadline->tv_nsec;
+	uint64_t end_ns = (now_ns / tick_ns + ticks) * tick_ns;
+	pDeadline->tv_sec = end_ns / 1000000000UL;
+	pDeadline->tv_nsec = end_ns % 1000000000UL;
+}
+
+static void heapTake(size_t bytes)
+{
+	pthread_mutex_lock(&tasksLock);
+	heapUsed += bytes;
+	pthread_mutex_unlock(&tasksLock);
+}
+
+// CPU time the task's thread has used.
+static uint64_t taskCpu_us(TaskHandle_t task)
+{
+	clockid_t clock;
+	struct timespec cpu;
+
+	if ((pthread_getcpuclockid(task->thread, &clock) != 0) ||
+	    (clock_gettime(clock, &cpu) != 0)) {
+		return 0;
+	}
+
+	return (uint64_t)cpu.tv_sec * 1000000 + cpu.tv_nsec / 1000;
+}
+
+// The task's state from the host scheduler's: runnable or sleeping.
+static eTaskState taskState(TaskHandle_t task)
+{
+	char path[64];
+	char stat[256];
+	char *p;
+	FILE *f;
+	size_t len;
+
+	if (pthread_equal(task->thread, pthread_self())) {
+		return eRunning;
+	}
+
+	snprintf(path, sizeof(path), "/proc/self/task/%d/stat", (int)task->tid);
+	f = fopen(path, "r");
+	if (f == 0) {
+		return eReady;
+	}
+	len = fread(stat, 1, sizeof(stat) - 1, f);
+	fclose(f);
+	stat[len] = 0;
+
+	// State follows the parenthesised name
+	p = strrchr(stat, ')');
+	return ((p != 0) && (p[1] == ' ') && (p[2] == 'R')) ? eReady : eBlocked;
+}
+
+static void *taskEntry(void *arg)
+{
+	TaskHandle_t task = (TaskHandle_t)arg;
+
+	pthread_setname_np(pthread_self(), task->name);
+	task->tid = (pid_t)syscall(SYS_gettid);
+	task->fn(task->params);
+
+	return 0;
+}
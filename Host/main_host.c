@@ -0,0 +1,527 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+// Linux simulation of the demo: the tasks from Src/main.c (the shell
+// optional), running against the simulated hub and console UART.  Prints
+// throughput and drop counters to stderr when it finishes.
+//
+// Usage: sh_sim [options]
+//   -t seconds   run time (default 10)
+//   -b baud      console baud rate (default 115200)
+//   -r id=us     also enable sensor id at a report interval (repeatable)
+//   -j percent   report interval jitter (default 0)
+//   -i hz        I2C clock (default 400000)
+//   -f reports   hub FIFO length (default 64)
+//   -u hubs      hubs sharing the bus, serviced by one task (default 1)
+//   -k ms        hub 0 stops reporting this long after start, until reset
+//   -o format    text, dsf or binary (default text)
+//   -l           lossy console
+//   -q           discard console output (still paced at the baud rate)
+//   -s           run the command shell on stdin
+//   -w seconds   start the timer this long before its 32-bit count wraps
+//   -d           check INTN waits with deadlines instead of running the app
+//                (exits 1 on failure; build with -DconfigTICK_RATE_HZ=n to
+//                check other tick rates)
+//   -c           check the console's tx ring instead of running the app:
+//                write blocks of several sizes, verify what the UART sent
+//                and print bytes/s and TX complete interrupts per KB
+//                (exits 1 on failure)
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "stm32f4xx_hal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "SensorHub.h"
+#include "SensorHubDev.h"
+#include "sh_sim.h"
+#include "sh_bno_stm32f401.h"
+#include "sensor_app.h"
+#include "console.h"
+#include "shell.h"
+#include "timebase.h"
+#include "app_tasks.h"
+#include "prof.h"
+
+#define SENSOR_TASK_STACK 512
+#define OUTPUT_TASK_STACK 512
+#define SHELL_TASK_STACK 512
+#define HOUSEKEEPING_TASK_STACK 384
+
+#define MAX_TASKS (8)
+
+// Deadline check: how late waits that time out may return on average (us).
+// (Single waits can be later, when the host is busy.)
+#define DEADLINE_LATE_US (1000)
+
+// Console check: bytes written at each block size, many times the ring
+#define CONSOLE_CHECK_BYTES (16 * 1024)
+
+// --- Private data ---------------------------------------------------
+
+static UART_HandleTypeDef huart2;
+static TIM_HandleTypeDef htim2;
+
+xTaskHandle sensorTaskHandle;
+xTaskHandle outputTaskHandle;
+xTaskHandle shellTaskHandle;
+xTaskHandle housekeepingTaskHandle;
+
+// As in Src/main.c.  The shell is left out without -s.
+static const appTask_t boardTasks[] = {
+	{ "SensorTask", sensorTask, SENSOR_TASK_STACK, 4, 2500,
+	  APP_TASK_ISR(EXTI15_10) | APP_TASK_ISR(EXTI9_5) | APP_TASK_ISR(TIM2) |
+	  APP_TASK_ISR(I2C1_EV) | APP_TASK_ISR(I2C1_ER) | APP_TASK_ISR(I2C1_DMA),
+	  &sensorTaskHandle },
+	{ "OutputTask", outputTask, OUTPUT_TASK_STACK, 3, 20000,
+	  // Released by SensorTask's queue sends; the ring space it waits for
+	  // is freed by the TX complete callback, from the USART2 TC interrupt.
+	  APP_TASK_ISR(USART2), &outputTaskHandle },
+	{ "ShellTask", shellTask, SHELL_TASK_STACK, 2, 100000,
+	  APP_TASK_ISR(USART2), &shellTaskHandle },
+	{ "Housekeeping", housekeepingTask, HOUSEKEEPING_TASK_STACK, 1, 1000000,
+	  APP_TASK_ISR(SYSTICK), &housekeepingTaskHandle },
+};
+static appTask_t appTasks[APP_TASKS_MAX];
+
+// Console check: the UART's output, and what the reader found in it
+static int checkPipe[2];
+static uint64_t checkReceived;
+static uint64_t checkBad;
+
+// --- Forward declarations -------------------------------------------
+
+static ssize_t consoleCookieWrite(void *cookie, const char *buf, size_t size);
+static int queueConfig(const char *arg);
+static void printResults(double elapsed_s);
+static int checkDeadlines(void);
+static int checkConsole(void);
+static void *checkReader(void *arg);
+static uint8_t checkByte(uint64_t offset);
+
+// --- Public methods -------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+	unsigned runTime_s = 10;
+	uint32_t baud = 115200;
+	sensorApp_output_t output = SENSOR_APP_OUTPUT_TEXT;
+	bool lossy = false;
+	bool quiet = false;
+	bool shell = false;
+	bool deadlines = false;
+	bool consoleCheck = false;
+	sim_params_t params = {
+		.jitter_pct = 0,
+		.i2cClock_hz = 400000,
+		.fifoLen = 64,
+		.units = 1,
+	};
+	unsigned wrapIn_s = 0;
+	const char *configs[8];
+	unsigned numConfigs = 0;
+	struct timespec start, end;
+	int opt;
+
+	// First thing in main(), as on the board
+	HAL_Init();
+	prof_init();
+
+	while ((opt = getopt(argc, argv, "t:b:r:j:i:f:u:k:o:lqsw:dc")) != -1) {
+		switch (opt) {
+		case 't':
+			runTime_s = strtoul(optarg, 0, 0);
+			break;
+		case 'b':
+			baud = strtoul(optarg, 0, 0);
+			break;
+		case 'r':
+			if (numConfigs < sizeof(configs)/sizeof(configs[0])) {
+				configs[numConfigs++] = optarg;
+			}
+			break;
+		case 'j':
+			params.jitter_pct = strtoul(optarg, 0, 0);
+			break;
+		case 'i':
+			params.i2cClock_hz = strtoul(optarg, 0, 0);
+			break;
+		case 'f':
+			params.fifoLen = strtoul(optarg, 0, 0);
+			break;
+		case 'u':
+			params.units = strtoul(optarg, 0, 0);
+			break;
+		case 'k':
+			params.hangAt_ms = strtoul(optarg, 0, 0);
+			break;
+		case 'o':
+			if (strcmp(optarg, "dsf") == 0) {
+				output = SENSOR_APP_OUTPUT_DSF;
+			}
+			else if (strcmp(optarg, "binary") == 0) {
+				output = SENSOR_APP_OUTPUT_BINARY;
+			}
+			break;
+		case 'l':
+			lossy = true;
+			break;
+		case 'q':
+			quiet = true;
+			break;
+		case 's':
+			shell = true;
+			break;
+		case 'w':
+			wrapIn_s = strtoul(optarg, 0, 0);
+			break;
+		case 'd':
+			deadlines = true;
+			break;
+		case 'c':
+			consoleCheck = true;
+			break;
+		default:
+			fprintf(stderr, "See the comment at the top of main_host.c for options.\n");
+			return 1;
+		}
+	}
+	if ((params.i2cClock_hz == 0) || (console_actualBaud(baud) == 0)) {
+		fprintf(stderr, "Bad I2C clock or baud rate.\n");
+		return 1;
+	}
+	if ((params.units == 0) || (params.units > MAX_SH_UNITS)) {
+		fprintf(stderr, "Hubs must be 1 to %d.\n", MAX_SH_UNITS);
+		return 1;
+	}
+
+	// Timebase on TIM2, as set up by MX_TIM2_Init and bno_init
+	htim2.Instance = TIM2;
+	__HAL_TIM_SET_PRESCALER(&htim2, 83);
+	if (wrapIn_s != 0) {
+		__HAL_TIM_SET_COUNTER(&htim2, 0 - wrapIn_s * 1000000u);
+	}
+	timebase_init(&htim2);
+
+	// Console UART, and stdout routed through it like __write on the board
+	int outFd = quiet ? -1 : STDOUT_FILENO;
+	if (consoleCheck) {
+		if (pipe(checkPipe) != 0) {
+			perror("pipe");
+			return 1;
+		}
+		outFd = checkPipe[1];
+	}
+	huart2.Instance = USART2;
+	huart2.Init.BaudRate = baud;
+	console_init(&huart2);
+	host_uartStart(&huart2, outFd, shell ? STDIN_FILENO : -1);
+	console_setLossy(lossy);
+
+	cookie_io_functions_t io = { .write = consoleCookieWrite };
+	stdout = fopencookie(0, "w", io);
+	setvbuf(stdout, 0, _IOLBF, 128);
+
+	sim_setParams(&params);
+	if (deadlines) {
+		return checkDeadlines();
+	}
+	if (consoleCheck) {
+		return checkConsole();
+	}
+
+	sensorApp_init();
+	sensorApp_setOutput(output);
+	for (unsigned n = 0; n < numConfigs; n++) {
+		if (queueConfig(configs[n]) != 0) {
+			fprintf(stderr, "Bad sensor config: %s\n", configs[n]);
+			return 1;
+		}
+	}
+
+	unsigned numTasks = 0;
+	for (unsigned n = 0; n < sizeof(boardTasks)/sizeof(boardTasks[0]); n++) {
+		if (shell || (boardTasks[n].entry != shellTask)) {
+			appTasks[numTasks++] = boardTasks[n];
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	appTasks_create(appTasks, numTasks);
+
+	vTaskDelay(runTime_s * configTICK_RATE_HZ);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	fflush(stdout);
+	printResults((end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+	// Tasks never return; leave them running to the end.
+	return 0;
+}
+
+void TIM2_IRQHandler(void)
+{
+	timebase_irqHandler();
+}
+
+// --- Private methods ----------------------------------------------
+
+static ssize_t consoleCookieWrite(void *cookie, const char *buf, size_t size)
+{
+	return console_write(buf, size);
+}
+
+// Queue a sensor config from "id=interval_us".
+static int queueConfig(const char *arg)
+{
+	sh_SensorConfig_t config;
+	char *end;
+
+	long sensor = strtol(arg, &end, 0);
+	if (*end != '=') {
+		return -1;
+	}
+	unsigned long interval = strtoul(end + 1, &end, 0);
+	if (*end != 0) {
+		return -1;
+	}
+
+	memset(&config, 0, sizeof(config));
+	config.reportInterval_us = interval;
+
+	return sensorApp_setConfig(sensor, &config);
+}
+
+static void printResults(double elapsed_s)
+{
+	sim_stats_t sim;
+	const char *names[MAX_TASKS];
+	uint64_t cpu_us[MAX_TASKS];
+
+	// The app's own counters, written straight to stderr
+	FILE *console = stdout;
+	stdout = stderr;
+	sensorApp_printStats();
+	stdout = console;
+
+	// Each hub, then the bus they share
+	uint32_t reports = 0;
+	uint32_t i2cTransfers = 0;
+	uint32_t i2cBytes = 0;
+	uint64_t i2cBusy_us = 0;
+	for (int unit = 0; unit < bno_numUnits(); unit++) {
+		sim_getStats(unit, &sim);
+		fprintf(stderr, "Hub %d: %u reports, %u lost to FIFO overflow, FIFO max %u.  "
+		        "INTN edges %u.\n",
+		        unit, sim.reports, sim.overflows, sim.fifoHighWater, sim.intnEdges);
+		fprintf(stderr, "Timestamp mismatches: %u.  Timebase errors: %u.  "
+		        "Resets: %u.\n",
+		        sim.timestampErrors, sim.timebaseErrors, sim.resets);
+		reports += sim.reports;
+		i2cTransfers += sim.i2cTransfers;
+		i2cBytes += sim.i2cBytes;
+		i2cBusy_us += sim.i2cBusy_us;
+	}
+	fprintf(stderr, "I2C: %u transfers, %u bytes, bus busy %.1f%%.\n",
+	        i2cTransfers, i2cBytes,
+	        100.0 * i2cBusy_us / (elapsed_s * 1e6));
+	fprintf(stderr, "Run time %.3f s, %.1f reports/s.\n",
+	        elapsed_s, reports / elapsed_s);
+
+	unsigned count = host_getTaskTimes(names, cpu_us, MAX_TASKS);
+	for (unsigned n = 0; (n < count) && (n < MAX_TASKS); n++) {
+		fprintf(stderr, "  %-12s CPU %8.3f ms\n", names[n], cpu_us[n] / 1000.0);
+	}
+}
+
+// Wait on hub 0 with deadlines.  With no sensor enabled each wait must
+// time out, not before its deadline and DEADLINE_LATE_US after it on
+// average; with one reporting every 2.5ms each must end on INTN.  Returns
+// 0 if they did.
+static int checkDeadlines(void)
+{
+	static const uint32_t waits_us[] = {
+		50, 300, 999, 1000, 1001, 2500, 4000, 10000, 25000,
+	};
+	static const uint16_t waits_ms[] = { 1, 5, 20 };
+	sh_SensorConfig_t config;
+	sh_SensorEvent_t event;
+	unsigned early = 0, wrong = 0, timeouts = 0, edges = 0;
+	uint32_t maxLate_us = 0;
+	uint64_t totalLate_us = 0;
+
+	void *pSensorHub = sh_init(0);
+	void *pDev = shdev_init(0);
+
+	for (int pass = 0; pass < 3; pass++) {
+		for (unsigned n = 0; n < sizeof(waits_us)/sizeof(waits_us[0]); n++) {
+			uint32_t deadline_us = timebase_now32() + waits_us[n];
+			bno_waitResult_t result = bno_waitIntnUntil(0, deadline_us);
+			int32_t late_us = (int32_t)(timebase_now32() - deadline_us);
+
+			timeouts++;
+			if (result != BNO_WAIT_TIMEOUT) {
+				wrong++;
+			}
+			else if (late_us < 0) {
+				early++;
+			}
+			else {
+				totalLate_us += late_us;
+				if (late_us > maxLate_us) {
+					maxLate_us = late_us;
+				}
+			}
+		}
+
+		// The driver's own wait, in ms
+		for (unsigned n = 0; n < sizeof(waits_ms)/sizeof(waits_ms[0]); n++) {
+			uint32_t start_us = timebase_now32();
+			shdev_waitIntn(pDev, waits_ms[n]);
+			int32_t late_us = (int32_t)(timebase_now32() - start_us) -
+				(int32_t)waits_ms[n] * 1000;
+
+			timeouts++;
+			if (late_us < 0) {
+				early++;
+			}
+			else {
+				totalLate_us += late_us;
+				if (late_us > maxLate_us) {
+					maxLate_us = late_us;
+				}
+			}
+		}
+	}
+
+	memset(&config, 0, sizeof(config));
+	config.reportInterval_us = 2500;
+	sh_setSensorConfig(pSensorHub, SH_ROTATION_VECTOR, &config);
+	for (int n = 0; n < 50; n++) {
+		edges++;
+		if (bno_waitIntnUntil(0, timebase_now32() + 20000) != BNO_WAIT_EDGE) {
+			wrong++;
+		}
+		else {
+			sh_getEvent(pSensorHub, &event);
+		}
+	}
+
+	uint32_t meanLate_us = totalLate_us / timeouts;
+	fprintf(stderr, "Deadlines at %u Hz tick: %u timeouts (%u early, late mean "
+	        "%u us, max %u us), %u edges, %u wrong results.\n",
+	        (unsigned)configTICK_RATE_HZ, timeouts, early, meanLate_us,
+	        maxLate_us, edges, wrong);
+
+	return ((early != 0) || (meanLate_us > DEADLINE_LATE_US) || (wrong != 0)) ? 1 : 0;
+}
+
+// Write CONSOLE_CHECK_BYTES through console_write in blocks of each size,
+// the odd ones wrapping the ring mid block, and the largest bigger than
+// it.  A reader checks that the UART sent every byte once, in order.
+// Returns 0 if it did.
+static int checkConsole(void)
+{
+	static const unsigned blocks[] = { 1, 7, 64, 100, 333, 1000, 1500 };
+	static uint8_t block[1500];
+	console_stats_t before, after;
+	struct timespec start, end;
+	pthread_t reader;
+	uint64_t offset = 0;
+	uint32_t lost = 0;
+
+	pthread_create(&reader, 0, checkReader, 0);
+
+	fprintf(stderr, "Console at %u baud, %u byte ring, %u bytes per block size:\n",
+	        huart2.Init.BaudRate, CONSOLE_TXBUFLEN, CONSOLE_CHECK_BYTES);
+	fprintf(stderr, "  Block   Bytes/s  TX ISRs  ISRs/KB\n");
+	for (unsigned n = 0; n < sizeof(blocks)/sizeof(blocks[0]); n++) {
+		unsigned written = 0;
+
+		console_flush();
+		console_getStats(&before);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		while (written < CONSOLE_CHECK_BYTES) {
+			unsigned len = CONSOLE_CHECK_BYTES - written;
+			if (len > blocks[n]) {
+				len = blocks[n];
+			}
+			for (unsigned i = 0; i < len; i++) {
+				block[i] = checkByte(offset++);
+			}
+			console_write(block, len);
+			written += len;
+		}
+		console_flush();
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		console_getStats(&after);
+
+		double elapsed_s = (end.tv_sec - start.tv_sec) +
+			(end.tv_nsec - start.tv_nsec) / 1e9;
+		uint32_t sent = after.txBytes - before.txBytes;
+		uint32_t isrs = after.txDmaTransfers - before.txDmaTransfers;
+		if (sent != written) {
+			lost += written - sent;
+		}
+		fprintf(stderr, "  %5u %9.0f %8u %8.2f\n", blocks[n],
+		        sent / elapsed_s, isrs, isrs * 1024.0 / sent);
+	}
+
+	// Nothing is in flight after the flush: end the reader's input.
+	close(checkPipe[1]);
+	pthread_join(reader, 0);
+
+	fprintf(stderr, "Wrote %llu bytes, UART sent %llu, %llu out of place.\n",
+	        (unsigned long long)offset, (unsigned long long)checkReceived,
+	        (unsigned long long)checkBad);
+
+	return ((lost != 0) || (checkReceived != offset) || (checkBad != 0)) ? 1 : 0;
+}
+
+// Compare the UART's output with the pattern, to the end of the pipe.
+static void *checkReader(void *arg)
+{
+	uint8_t buf[256];
+	ssize_t len;
+
+	while ((len = read(checkPipe[0], buf, sizeof(buf))) > 0) {
+		for (ssize_t i = 0; i < len; i++) {
+			if (buf[i] != checkByte(checkReceived++)) {
+				checkBad++;
+			}
+		}
+	}
+
+	return 0;
+}
+
+// The byte at an offset in the check stream.  No LF, so nothing expands
+// to CR-LF, and a period prime to the block sizes.
+static uint8_t checkByte(uint64_t offset)
+{
+	return 'a' + offset % 23;
+}
@@ -0,0 +1,74 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef SH_SIM_H
+#define SH_SIM_H
+
+// Simulated BNO070 for the Linux build.  sh_sim_dev.c implements shdev_*
+// over a hub thread that produces input reports at the configured rates;
+// sh_sim_hub.c is the matching SH-1 API stand-in.
+
+#include <stdint.h>
+
+// Input report, as read over I2C (little endian):
+//   [0..1] length of the report, 0 if the hub had nothing to send
+//   [2]    report id (sensor)
+//   [3]    sequence number
+//   [4]    status
+//   [5]    delay from sample to INTN, 100us units
+//   [6..]  SIM_NUM_VALUES int16 values
+#define SIM_NUM_VALUES (5)
+#define SIM_REPORT_LEN (6 + 2*SIM_NUM_VALUES)
+
+// Commands, written over I2C
+#define SIM_CMD_SET_CONFIG (0xFD)    // sensor, flags, sens (2), interval_us (4)
+#define SIM_CMD_GET_PROD_IDS (0xF9)  // read back SH_NUM_PRODUCT_IDS x 12 bytes
+#define SIM_SET_CONFIG_LEN (9)
+#define SIM_PROD_ID_LEN (12)
+
+#define SIM_FLAG_CHANGE_ENABLED  (0x01)
+#define SIM_FLAG_CHANGE_RELATIVE (0x02)
+#define SIM_FLAG_WAKEUP_ENABLED  (0x04)
+
+typedef struct sim_params_s {
+	uint32_t jitter_pct;     // random variation of report intervals, percent
+	uint32_t i2cClock_hz;    // bus clock, sets I2C transfer time
+	unsigned fifoLen;        // reports the hub buffers before losing them
+	unsigned units;          // hubs on the bus, up to MAX_SH_UNITS
+	uint32_t hangAt_ms;      // hub 0 stops reporting until reset, 0 never
+} sim_params_t;
+
+typedef struct sim_stats_s {
+	uint32_t reports;        // reports generated
+	uint32_t overflows;      // reports lost to a full hub FIFO
+	uint32_t intnEdges;      // INTN assertions
+	uint32_t i2cTransfers;
+	uint32_t i2cBytes;
+	uint64_t i2cBusy_us;     // time the bus was occupied
+	unsigned fifoHighWater;
+	uint32_t timestampErrors; // reads given another report's INTN time
+	uint32_t timebaseErrors;  // timebase readings outside TIM2's true count
+	uint32_t resets;
+} sim_stats_t;
+
+// Set simulation parameters.  Call before shdev_init.
+void sim_setParams(const sim_params_t *pParams);
+
+void sim_getStats(int unit, sim_stats_t *pStats);
+
+#endif
@@ -0,0 +1,778 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+// Implementation of SensorHubDev API for the Linux simulation build.  Stands
+// in for sh_bno_stm32f401.c: each unit is a hub thread that samples its
+// enabled sensors at their report intervals, queues input reports in a
+// bounded FIFO and asserts INTN, which the driver answers with I2C reads.
+
+#define _GNU_SOURCE
+#include "SensorHubDev.h"
+#include "sh_sim.h"
+#include "sh_bno_stm32f401.h"
+#include "intn_fifo.h"
+#include "timebase.h"
+#include "prof.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+// Defaults for sim_params_t
+#define SIM_JITTER_PCT (0)
+#define SIM_I2C_CLOCK_HZ (400000)
+#define SIM_FIFO_LEN (64)
+#define SIM_UNITS (1)
+
+// Bits on the wire per I2C byte: 8 data and ACK
+#define I2C_BITS_PER_BYTE (9)
+
+// --- Type Definitions ---------------------------------------------------
+
+typedef struct simReport_s {
+	uint64_t sample_us;
+	uint32_t edge_us;      // INTN edge that announced it
+	uint8_t data[SIM_REPORT_LEN];
+} simReport_t;
+
+typedef struct simSensor_s {
+	uint32_t interval_us;   // 0 when disabled
+	uint64_t nextDue_us;
+	uint8_t sequence;
+} simSensor_t;
+
+typedef struct simDev_s {
+	int unit;
+	bool dfuMode;
+
+	// Semaphore to notify of changes on intn
+	SemaphoreHandle_t intnSem;
+
+	// Sanitized INTN, as in sh_bno_stm32f401.c: false when asserted, set
+	// back to true by the i2c read that services it.
+	volatile bool intnStatus;
+	uint32_t intnSequence;
+
+	// INTN edges waiting for their reads, as on the board, and the edge
+	// matched to the most recent read.
+	intnFifo_t intnFifo;
+	intnEdge_t readEdge;
+
+	// What the hub knows: the edge that announced the report last read
+	uint32_t readReportEdge_us;
+
+	// Hub state, shared with the hub thread
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	bool started;
+	simSensor_t sensor[SH_MAX_SENSOR_ID+1];
+	simReport_t *fifo;
+	unsigned fifoHead;
+	unsigned fifoCount;
+	bool prodIdsPending;
+	unsigned seed;
+	bool hung;                // stopped reporting (hangAt_ms), until reset
+	bool hangDone;
+
+	sim_stats_t stats;
+} simDev_t;
+
+// --- Forward Declarations ------------------------------------------------
+
+static void *hubThread(void *arg);
+static void sample(simDev_t *pDev, int sensor, uint64_t t_us);
+static void intnEdge(simDev_t *pDev, uint64_t now_us);
+static uint32_t assertIntn(simDev_t *pDev);
+static void setConfig(simDev_t *pDev, const uint8_t *pCmd);
+static void readProdIds(uint8_t *pReceive, unsigned receiveLen);
+static void readReport(simDev_t *pDev, uint8_t *pReceive, unsigned receiveLen);
+static void busTime(unsigned bytes);
+static bool takeUntil(SemaphoreHandle_t sem, uint32_t deadline_us);
+static uint64_t now_us(void);
+static void usToTimespec(struct timespec *pTs, uint64_t t_us);
+
+// --- Private Data --------------------------------------------------------
+
+static simDev_t simDev[MAX_SH_UNITS];
+
+static sim_params_t params = {
+	.jitter_pct = SIM_JITTER_PCT,
+	.i2cClock_hz = SIM_I2C_CLOCK_HZ,
+	.fifoLen = SIM_FIFO_LEN,
+	.units = SIM_UNITS,
+};
+
+// One bus shared by all units
+static pthread_mutex_t busLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Given on INTN of any unit, for bno_waitIntnAny
+static SemaphoreHandle_t intnAnySem;
+
+// CLOCK_MONOTONIC at startup, origin of the us timebase
+static struct timespec epoch;
+
+// Waits with deadlines
+static pthread_mutex_t deadlineLock = PTHREAD_MUTEX_INITIALIZER;
+static bno_deadlineStats_t deadlineStats;
+
+// --- Public API ----------------------------------------------------------
+
+void sim_setParams(const sim_params_t *pParams)
+{
+	params = *pParams;
+	if (params.fifoLen == 0) {
+		params.fifoLen = 1;
+	}
+	if (params.units == 0) {
+		params.units = 1;
+	}
+	if (params.units > MAX_SH_UNITS) {
+		params.units = MAX_SH_UNITS;
+	}
+}
+
+void sim_getStats(int unit, sim_stats_t *pStats)
+{
+	if ((unit < 0) || (unit >= MAX_SH_UNITS)) {
+		memset(pStats, 0, sizeof(*pStats));
+		return;
+	}
+
+	simDev_t *pDev = &simDev[unit];
+	if (!pDev->started) {
+		memset(pStats, 0, sizeof(*pStats));
+		return;
+	}
+	pthread_mutex_lock(&pDev->lock);
+	*pStats = pDev->stats;
+	pthread_mutex_unlock(&pDev->lock);
+}
+
+void * shdev_init(int unit)
+{
+	pthread_condattr_t attr;
+	pthread_t thread;
+
+	// Validate unit
+	if ((unit < 0) || (unit >= params.units)) {
+		// no such unit
+		return 0;
+	}
+
+	simDev_t *pDev = &simDev[unit];
+
+	if (!pDev->started) {
+		pDev->started = true;
+		if ((epoch.tv_sec == 0) && (epoch.tv_nsec == 0)) {
+			clock_gettime(CLOCK_MONOTONIC, &epoch);
+			intnAnySem = xSemaphoreCreateBinary();
+		}
+
+		pDev->unit = unit;
+		pDev->intnSem = xSemaphoreCreateBinary();
+		intnFifo_init(&pDev->intnFifo);
+		pthread_mutex_init(&pDev->lock, 0);
+		pthread_condattr_init(&attr);
+		pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+		pthread_cond_init(&pDev->changed, &attr);
+		pthread_condattr_destroy(&attr);
+		pDev->fifo = calloc(params.fifoLen, sizeof(simReport_t));
+		pDev->seed = 1 + unit;
+
+		pthread_create(&thread, 0, hubThread, pDev);
+		pthread_detach(thread);
+	}
+
+	pDev->dfuMode = false;
+
+	// INTN deasserted
+	pDev->intnStatus = true;
+
+	return pDev;
+}
+
+sh_Status_t shdev_reset(void * dev)
+{
+	simDev_t *pDev = (simDev_t *)dev;
+
+	pthread_mutex_lock(&pDev->lock);
+	pDev->dfuMode = false;
+
+	// Reset clears all sensor configuration and pending reports
+	memset(pDev->sensor, 0, sizeof(pDev->sensor));
+	pDev->fifoHead = 0;
+	pDev->fifoCount = 0;
+	pDev->prodIdsPending = false;
+	pDev->hung = false;
+	pDev->stats.resets++;
+
+	// INTN deasserted, edges from before the reset will never be read
+	pDev->intnStatus = true;
+	intnFifo_flush(&pDev->intnFifo);
+	pthread_cond_broadcast(&pDev->changed);
+	pthread_mutex_unlock(&pDev->lock);
+
+	// The simulated hub is ready as soon as it leaves reset, so there is
+	// nothing to wait for.
+
+	return SH_STATUS_SUCCESS;
+}
+
+sh_Status_t shdev_reset_dfu(void * dev)
+{
+	simDev_t *pDev = (simDev_t *)dev;
+
+	shdev_reset(dev);
+
+	// No bootloader is simulated; I2C fails until the next normal reset.
+	pDev->dfuMode = true;
+
+	return SH_STATUS_SUCCESS;
+}
+
+sh_Status_t shdev_i2c(void *dev,
+                      const uint8_t *pSend, unsigned sendLen,
+                      uint8_t *pReceive, unsigned receiveLen)
+{
+	simDev_t *pDev = (simDev_t *)dev;
+
+	if ((sendLen == 0) && (receiveLen == 0)) {
+		// Nothing to send, skip the whole thing
+		return SH_STATUS_SUCCESS;
+	}
+
+	if (pDev->dfuMode) {
+		// Nobody answers at the bootloader address
+		return SH_STATUS_ERROR_I2C_IO;
+	}
+	uint32_t start = prof_begin();
+
+	pthread_mutex_lock(&busLock);
+
+	// Address byte for each direction, then the data
+	unsigned bytes = sendLen + receiveLen +
+		((sendLen != 0) ? 1 : 0) + ((receiveLen != 0) ? 1 : 0);
+	busTime(bytes);
+
+	pthread_mutex_lock(&pDev->lock);
+	pDev->stats.i2cTransfers++;
+	pDev->stats.i2cBytes += bytes;
+	pDev->stats.i2cBusy_us += (uint64_t)bytes * I2C_BITS_PER_BYTE *
+		1000000 / params.i2cClock_hz;
+
+	if (sendLen != 0) {
+		if ((pSend[0] == SIM_CMD_SET_CONFIG) && (sendLen >= SIM_SET_CONFIG_LEN)) {
+			setConfig(pDev, pSend);
+		}
+		else if (pSend[0] == SIM_CMD_GET_PROD_IDS) {
+			// Response is announced like any other report
+			pDev->prodIdsPending = true;
+			assertIntn(pDev);
+		}
+	}
+
+	if (receiveLen != 0) {
+		// INTN deasserted, this read answers the oldest edge
+		pDev->intnStatus = true;
+		intnFifo_pop(&pDev->intnFifo, &pDev->readEdge);
+
+		if (pDev->prodIdsPending) {
+			pDev->prodIdsPending = false;
+			pDev->readReportEdge_us = pDev->readEdge.timestamp_us;
+			readProdIds(pReceive, receiveLen);
+		}
+		else {
+			readReport(pDev, pReceive, receiveLen);
+		}
+	}
+	pthread_mutex_unlock(&pDev->lock);
+
+	pthread_mutex_unlock(&busLock);
+	prof_end(PROF_SHDEV_I2C, start);
+
+	return SH_STATUS_SUCCESS;
+}
+
+bool shdev_getIntn(void *dev)
+{
+	simDev_t *pDev = (simDev_t *)dev;
+
+	return pDev->intnStatus;
+}
+
+bool shdev_waitIntn(void *dev, uint16_t wait_ms)
+{
+	simDev_t *pDev = (simDev_t *)dev;
+
+	if (wait_ms == SH_WAIT_FOREVER) {
+		xSemaphoreTake(pDev->intnSem, portMAX_DELAY);
+	}
+	else {
+		takeUntil(pDev->intnSem, timebase_now32() + (uint32_t)wait_ms * 1000);
+	}
+
+	return pDev->intnStatus;
+}
+
+uint32_t shdev_getTimestamp_us(void *dev)
+{
+	simDev_t *pDev = (simDev_t *)dev;
+	uint32_t timestamp_us = pDev->readEdge.timestamp_us;
+
+	// Check the match against what the hub knows
+	pthread_mutex_lock(&pDev->lock);
+	if (timestamp_us != pDev->readReportEdge_us) {
+		pDev->stats.timestampErrors++;
+	}
+	pthread_mutex_unlock(&pDev->lock);
+
+	return timestamp_us;
+}
+
+void bno_getIntnStats(int unit, intnFifo_stats_t *pStats)
+{
+	if ((unit < 0) || (unit >= MAX_SH_UNITS)) {
+		return;
+	}
+
+	intnFifo_getStats(&simDev[unit].intnFifo, pStats);
+}
+
+unsigned bno_numUnits(void)
+{
+	return params.units;
+}
+
+uint32_t bno_waitIntnAny(uint32_t wait_ms)
+{
+	uint32_t deadline_us = timebase_now32() + wait_ms * 1000;
+	uint32_t mask = 0;
+
+	for (int pass = 0; (pass < 2) && (mask == 0); pass++) {
+		if (pass != 0) {
+			// An edge since the check left the semaphore given
+			if (wait_ms == SH_WAIT_FOREVER) {
+				xSemaphoreTake(intnAnySem, portMAX_DELAY);
+			}
+			else {
+				takeUntil(intnAnySem, deadline_us);
+			}
+		}
+		for (unsigned unit = 0; unit < params.units; unit++) {
+			if (simDev[unit].started && !simDev[unit].intnStatus) {
+				mask |= 1u << unit;
+			}
+		}
+	}
+
+	return mask;
+}
+
+bno_waitResult_t bno_waitIntnUntil(int unit, uint32_t deadline_us)
+{
+	simDev_t *pDev = &simDev[unit];
+
+	// The semaphore may be left over from an edge already read
+	while (pDev->intnStatus) {
+		if (!takeUntil(pDev->intnSem, deadline_us)) {
+			return pDev->intnStatus ? BNO_WAIT_TIMEOUT : BNO_WAIT_EDGE;
+		}
+	}
+
+	return BNO_WAIT_EDGE;
+}
+
+void bno_getDeadlineStats(bno_deadlineStats_t *pStats)
+{
+	pthread_mutex_lock(&deadlineLock);
+	*pStats = deadlineStats;
+	pthread_mutex_unlock(&deadlineLock);
+}
+
+// The simulated bus has no interrupt or DMA cost to report.
+void bno_setI2cDma(bool dma)
+{
+}
+
+bool bno_getI2cDma(void)
+{
+	return false;
+}
+
+void bno_getI2cCost(bno_i2cCost_t *pIt, bno_i2cCost_t *pDma)
+{
+	memset(pIt, 0, sizeof(*pIt));
+	memset(pDma, 0, sizeof(*pDma));
+}
+
+// The simulation wakes tasks with its own semaphores and doesn't time them.
+void bno_getWakeStats(bno_wakeStats_t *pI2c, bno_wakeStats_t *pIntn)
+{
+	memset(pI2c, 0, sizeof(*pI2c));
+	memset(pIntn, 0, sizeof(*pIntn));
+}
+
+// The simulated bus never faults.
+void bno_getI2cRecovery(bno_i2cRecovery_t *pStats)
+{
+	memset(pStats, 0, sizeof(*pStats));
+}
+
+uint32_t bno_i2cBusClears(void)
+{
+	return 0;
+}
+
+// Every simulated reset is ready at once.
+void bno_getResetStats(int unit, bno_resetStats_t *pStats)
+{
+	memset(pStats, 0, sizeof(*pStats));
+	if ((unit < 0) || (unit >= MAX_SH_UNITS)) {
+		return;
+	}
+
+	pStats->resets = simDev[unit].stats.resets;
+}
+
+// The simulated hub has no capture channel; its edges are EXTI-style.
+void bno_getIntnCaptureStats(bno_intnCaptureStats_t *pStats)
+{
+	memset(pStats, 0, sizeof(*pStats));
+	pStats->mode = BNO_INTN_TS_EXTI;
+}
+
+bool bno_popIntnCompare(bno_intnCompare_t *pEdge)
+{
+	return false;
+}
+
+// --- Private functions ---------------------------------------------------
+
+// Produce each enabled sensor's reports when they fall due.
+static void *hubThread(void *arg)
+{
+	simDev_t *pDev = (simDev_t *)arg;
+	struct timespec due;
+
+	pthread_mutex_lock(&pDev->lock);
+	while (1) {
+		// Find the sensor due soonest
+		int next = -1;
+		for (int n = 0; n <= SH_MAX_SENSOR_ID; n++) {
+			if ((pDev->sensor[n].interval_us != 0) &&
+			    ((next < 0) ||
+			     (pDev->sensor[n].nextDue_us < pDev->sensor[next].nextDue_us))) {
+				next = n;
+			}
+		}
+
+		if (next < 0) {
+			// Nothing enabled
+			pthread_cond_wait(&pDev->changed, &pDev->lock);
+			continue;
+		}
+
+		uint64_t t = pDev->sensor[next].nextDue_us;
+		if (t > now_us()) {
+			// Sleep until then, or until the config changes
+			usToTimespec(&due, t);
+			pthread_cond_timedwait(&pDev->changed, &pDev->lock, &due);
+			continue;
+		}
+
+		if ((pDev->unit == 0) && (params.hangAt_ms != 0) && !pDev->hangDone &&
+		    (t >= (uint64_t)params.hangAt_ms * 1000)) {
+			// Firmware wedged: nothing more until a reset
+			pDev->hangDone = true;
+			pDev->hung = true;
+		}
+		if (pDev->hung) {
+			pthread_cond_wait(&pDev->changed, &pDev->lock);
+			continue;
+		}
+
+		sample(pDev, next, t);
+
+		// Schedule the next one, varying the interval by up to +/- jitter
+		simSensor_t *pSensor = &pDev->sensor[next];
+		int64_t interval = pSensor->interval_us;
+		if (params.jitter_pct != 0) {
+			int span = 2 * params.jitter_pct + 1;
+			int pct = (int)(rand_r(&pDev->seed) % span) - (int)params.jitter_pct;
+			interval += interval * pct / 100;
+		}
+		pSensor->nextDue_us += (interval > 0) ? interval : 1;
+
+		if (pDev->intnStatus && (pDev->fifoCount != 0)) {
+			intnEdge(pDev, now_us());
+		}
+	}
+
+	return 0;
+}
+
+// Queue a report from one sensor, sampled at t_us.  Call holding lock.
+static void sample(simDev_t *pDev, int sensor, uint64_t t_us)
+{
+	simSensor_t *pSensor = &pDev->sensor[sensor];
+	int16_t v[SIM_NUM_VALUES] = {0};
+	uint8_t status = 3;    // accuracy: high
+	double t = t_us / 1e6;
+	double yaw = 0.5 * t;  // turning slowly about z, rad
+	int noise = (int)(rand_r(&pDev->seed) % 17) - 8;
+
+	pDev->stats.reports++;
+	pSensor->sequence++;
+
+	switch (sensor) {
+	case SH_ROTATION_VECTOR:
+		v[0] = (int16_t)lrint(cos(yaw / 2) * (1 << 14));
+		v[3] = (int16_t)lrint(sin(yaw / 2) * (1 << 14));
+		v[4] = (int16_t)lrint(0.0873 * (1 << 12));    // 5 degrees
+		break;
+	case SH_ACCELEROMETER:
+		v[0] = noise;
+		v[1] = -noise;
+		v[2] = (int16_t)lrint(9.80665 * (1 << 8)) + noise;
+		break;
+	case SH_MAGNETIC_FIELD_CALIBRATED:
+		v[0] = (int16_t)lrint(20.0 * cos(yaw) * (1 << 4));
+		v[1] = (int16_t)lrint(-20.0 * sin(yaw) * (1 << 4));
+		v[2] = (int16_t)lrint(-40.0 * (1 << 4));
+		break;
+	case SH_RAW_ACCELEROMETER:
+		v[0] = noise;
+		v[1] = -noise;
+		v[2] = 4096 + noise;
+		break;
+	case SH_RAW_GYROSCOPE:
+		v[0] = noise;
+		v[1] = noise;
+		v[2] = 900 + noise;
+		break;
+	case SH_RAW_MAGNETOMETER:
+		v[0] = (int16_t)lrint(200.0 * cos(yaw)) + noise;
+		v[1] = (int16_t)lrint(-200.0 * sin(yaw)) + noise;
+		v[2] = -400 + noise;
+		break;
+	default:
+		status = 0;
+		break;
+	}
+
+	if (pDev->fifoCount == params.fifoLen) {
+		// Host hasn't kept up, report is lost
+		pDev->stats.overflows++;
+		return;
+	}
+
+	unsigned index = (pDev->fifoHead + pDev->fifoCount) % params.fifoLen;
+	simReport_t *pReport = &pDev->fifo[index];
+	pReport->sample_us = t_us;
+	pReport->data[0] = SIM_REPORT_LEN & 0xFF;
+	pReport->data[1] = SIM_REPORT_LEN >> 8;
+	pReport->data[2] = sensor;
+	pReport->data[3] = pSensor->sequence;
+	pReport->data[4] = status;
+	pReport->data[5] = 0;
+	for (int n = 0; n < SIM_NUM_VALUES; n++) {
+		pReport->data[6 + 2*n] = (uint16_t)v[n] & 0xFF;
+		pReport->data[7 + 2*n] = (uint16_t)v[n] >> 8;
+	}
+
+	pDev->fifoCount++;
+	if (pDev->fifoCount > pDev->stats.fifoHighWater) {
+		pDev->stats.fifoHighWater = pDev->fifoCount;
+	}
+}
+
+// Assert INTN for the report at the head of the FIFO.  Call holding lock.
+static void intnEdge(simDev_t *pDev, uint64_t now_us)
+{
+	simReport_t *pReport = &pDev->fifo[pDev->fifoHead];
+
+	// Delay from sample to interrupt, 100us units
+	uint64_t delay = (now_us - pReport->sample_us) / 100;
+	pReport->data[5] = (delay > 0xFF) ? 0xFF : delay;
+	pReport->edge_us = assertIntn(pDev);
+}
+
+// Assert INTN, as the EXTI ISR on the board sees it, returning the edge's
+// timestamp.  Call holding lock.
+static uint32_t assertIntn(simDev_t *pDev)
+{
+	BaseType_t woken = pdFALSE;
+
+	// Stamp from the timebase, checking it against TIM2's unwrapped count
+	uint64_t before = host_timCount64();
+	uint64_t timestamp_us = timebase_now_us();
+	uint64_t after = host_timCount64();
+	if ((timestamp_us < before) || (timestamp_us > after)) {
+		pDev->stats.timebaseErrors++;
+	}
+
+	pDev->stats.intnEdges++;
+	pDev->intnSequence++;
+	intnFifo_push(&pDev->intnFifo, (uint32_t)timestamp_us, pDev->intnSequence);
+
+	// INTN asserted
+	pDev->intnStatus = false;
+
+	xSemaphoreGiveFromISR(pDev->intnSem, &woken);
+	xSemaphoreGiveFromISR(intnAnySem, &woken);
+
+	return (uint32_t)timestamp_us;
+}
+
+static void setConfig(simDev_t *pDev, const uint8_t *pCmd)
+{
+	int sensor = pCmd[1];
+	uint32_t interval = pCmd[5] | (pCmd[6] << 8) | (pCmd[7] << 16) |
+		((uint32_t)pCmd[8] << 24);
+
+	if (sensor > SH_MAX_SENSOR_ID) {
+		return;
+	}
+
+	// First report one interval from now
+	pDev->sensor[sensor].interval_us = interval;
+	pDev->sensor[sensor].nextDue_us = now_us() + interval;
+	pthread_cond_broadcast(&pDev->changed);
+}
+
+static void readProdIds(uint8_t *pReceive, unsigned receiveLen)
+{
+	memset(pReceive, 0, receiveLen);
+
+	for (int n = 0; n < SH_NUM_PRODUCT_IDS; n++) {
+		uint8_t *p = &pReceive[n * SIM_PROD_ID_LEN];
+		if ((n + 1) * SIM_PROD_ID_LEN > receiveLen) {
+			break;
+		}
+		// Part number, version 99.99.99, build 99 (like the stub Firmware.c)
+		uint32_t part = 10004000 + n;
+		p[0] = part & 0xFF;
+		p[1] = (part >> 8) & 0xFF;
+		p[2] = (part >> 16) & 0xFF;
+		p[3] = part >> 24;
+		p[4] = 99;
+		p[5] = 99;
+		p[6] = 99;
+		p[8] = 99;
+	}
+}
+
+// Read out the report at the head of the FIFO.  Call holding lock.
+static void readReport(simDev_t *pDev, uint8_t *pReceive, unsigned receiveLen)
+{
+	memset(pReceive, 0, receiveLen);
+	pDev->readReportEdge_us = pDev->readEdge.timestamp_us;
+
+	if (pDev->fifoCount != 0) {
+		simReport_t *pReport = &pDev->fifo[pDev->fifoHead];
+		memcpy(pReceive, pReport->data,
+		       (receiveLen < SIM_REPORT_LEN) ? receiveLen : SIM_REPORT_LEN);
+		pDev->readReportEdge_us = pReport->edge_us;
+		pDev->fifoHead = (pDev->fifoHead + 1) % params.fifoLen;
+		pDev->fifoCount--;
+	}
+
+	// Hub asserts INTN again if it has more to send
+	if (pDev->fifoCount != 0) {
+		intnEdge(pDev, now_us());
+	}
+}
+
+// Occupy the caller for as long as the bytes take on the bus.
+static void busTime(unsigned bytes)
+{
+	struct timespec ts;
+	uint64_t ns = (uint64_t)bytes * I2C_BITS_PER_BYTE * 1000000000ULL /
+		params.i2cClock_hz;
+
+	ts.tv_sec = ns / 1000000000ULL;
+	ts.tv_nsec = ns % 1000000000ULL;
+	while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) != 0) {
+		// interrupted, sleep the remainder
+	}
+}
+
+// Take sem by the time TIM2 reaches deadline_us.  Whole ticks block in
+// the RTOS, as on the board; the rest, which TIM2 CH4 ends there, is a
+// timed wait here.  Returns false on timeout.
+static bool takeUntil(SemaphoreHandle_t sem, uint32_t deadline_us)
+{
+	bool taken = false;
+	int32_t remaining_us;
+
+	while (!taken) {
+		remaining_us = (int32_t)(deadline_us - timebase_now32());
+		if (remaining_us <= 0) {
+			break;
+		}
+
+		TickType_t ticks = (uint64_t)remaining_us * configTICK_RATE_HZ / TIMEBASE_HZ;
+		if (ticks != 0) {
+			taken = (xSemaphoreTake(sem, ticks) == pdPASS);
+		}
+		else {
+			taken = (host_semaphoreTakeUs(sem, remaining_us) == pdPASS);
+		}
+	}
+
+	pthread_mutex_lock(&deadlineLock);
+	deadlineStats.waits++;
+	if (!taken) {
+		uint32_t late_us = timebase_now32() - deadline_us;
+
+		deadlineStats.timeouts++;
+		deadlineStats.totalLate_us += late_us;
+		if (late_us > deadlineStats.maxLate_us) {
+			deadlineStats.maxLate_us = late_us;
+		}
+	}
+	pthread_mutex_unlock(&deadlineLock);
+
+	return taken;
+}
+
+static uint64_t now_us(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)(now.tv_sec - epoch.tv_sec) * 1000000 +
+		(now.tv_nsec - epoch.tv_nsec) / 1000;
+}
+
+static void usToTimespec(struct timespec *pTs, uint64_t t_us)
+{
+	uint64_t ns = t_us * 1000 + epoch.tv_nsec;
+
+	pTs->tv_sec = epoch.tv_sec + ns / 1000000000ULL;
+	pTs->tv_nsec = ns % 1000000000ULL;
+}
@@ -0,0 +1,159 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+// Stand-in for the SH-1 driver, for the Linux simulation build.  Speaks the
+// simulated hub's report format (sh_sim.h) over the shdev_* interface, the
+// same way the real driver speaks SHTP to a BNO070.
+
+#include "SensorHub.h"
+#include "SensorHubDev.h"
+#include "sh_sim.h"
+
+#include <string.h>
+
+// How long sh_getEvent waits for INTN before giving up (ms)
+#define EVENT_WAIT_MS (100)
+
+// --- Type Definitions ---------------------------------------------------
+
+typedef struct sh_s {
+	void *pDev;
+} sh_t;
+
+// --- Private Data --------------------------------------------------------
+
+static sh_t sh[MAX_SH_UNITS];
+
+// --- Public API ----------------------------------------------------------
+
+void *sh_init(int unit)
+{
+	void *pDev = shdev_init(unit);
+	if (pDev == 0) {
+		return 0;
+	}
+
+	sh[unit].pDev = pDev;
+	shdev_reset(pDev);
+
+	return &sh[unit];
+}
+
+int sh_getEvent(void *pSensorHub, sh_SensorEvent_t *pEvent)
+{
+	sh_t *pSh = (sh_t *)pSensorHub;
+	uint8_t report[SIM_REPORT_LEN];
+	int rc;
+
+	// Wait for INTN
+	if (shdev_getIntn(pSh->pDev)) {
+		if (shdev_waitIntn(pSh->pDev, EVENT_WAIT_MS)) {
+			// Still deasserted
+			return SH_STATUS_TIMEOUT;
+		}
+	}
+
+	rc = shdev_i2c(pSh->pDev, 0, 0, report, sizeof(report));
+	if (rc != SH_STATUS_SUCCESS) {
+		return rc;
+	}
+
+	// Timestamp of the INTN edge that announced this report
+	uint32_t intn_us = shdev_getTimestamp_us(pSh->pDev);
+
+	unsigned len = report[0] | (report[1] << 8);
+	if (len < SIM_REPORT_LEN) {
+		return SH_STATUS_NO_EVENT;
+	}
+
+	memset(pEvent, 0, sizeof(*pEvent));
+	pEvent->sensor = report[2];
+	pEvent->sequenceNumber = report[3];
+	pEvent->status = report[4];
+	pEvent->delay = report[5];
+	pEvent->time_us = intn_us - 100 * (uint32_t)pEvent->delay;
+
+	// Every event layout is a run of int16 values
+	int16_t v[SIM_NUM_VALUES];
+	for (int n = 0; n < SIM_NUM_VALUES; n++) {
+		v[n] = (int16_t)(report[6 + 2*n] | (report[7 + 2*n] << 8));
+	}
+	memcpy(&pEvent->un, v,
+	       (sizeof(pEvent->un) < sizeof(v)) ? sizeof(pEvent->un) : sizeof(v));
+
+	return SH_STATUS_SUCCESS;
+}
+
+int sh_getProdIds(void *pSensorHub, sh_ProductId_t *pProdIds)
+{
+	sh_t *pSh = (sh_t *)pSensorHub;
+	const uint8_t cmd = SIM_CMD_GET_PROD_IDS;
+	uint8_t resp[SH_NUM_PRODUCT_IDS * SIM_PROD_ID_LEN];
+	int rc;
+
+	// Request, then read the response when INTN announces it
+	rc = shdev_i2c(pSh->pDev, &cmd, 1, 0, 0);
+	if (rc != SH_STATUS_SUCCESS) {
+		return rc;
+	}
+	if (shdev_getIntn(pSh->pDev) && shdev_waitIntn(pSh->pDev, EVENT_WAIT_MS)) {
+		return SH_STATUS_TIMEOUT;
+	}
+	rc = shdev_i2c(pSh->pDev, 0, 0, resp, sizeof(resp));
+	if (rc != SH_STATUS_SUCCESS) {
+		return rc;
+	}
+
+	for (int n = 0; n < SH_NUM_PRODUCT_IDS; n++) {
+		const uint8_t *p = &resp[n * SIM_PROD_ID_LEN];
+		pProdIds[n].swPartNumber = p[0] | (p[1] << 8) | (p[2] << 16) |
+			((uint32_t)p[3] << 24);
+		pProdIds[n].swVersionMajor = p[4];
+		pProdIds[n].swVersionMinor = p[5];
+		pProdIds[n].swVersionPatch = p[6] | (p[7] << 8);
+		pProdIds[n].swBuildNumber = p[8] | (p[9] << 8) | (p[10] << 16) |
+			((uint32_t)p[11] << 24);
+	}
+
+	return SH_STATUS_SUCCESS;
+}
+
+int sh_setSensorConfig(void *pSensorHub, sh_SensorId_t sensor,
+                       const sh_SensorConfig_t *pConfig)
+{
+	sh_t *pSh = (sh_t *)pSensorHub;
+	uint8_t cmd[SIM_SET_CONFIG_LEN];
+
+	if ((sensor < 0) || (sensor > SH_MAX_SENSOR_ID)) {
+		return SH_STATUS_BAD_PARAM;
+	}
+
+	cmd[0] = SIM_CMD_SET_CONFIG;
+	cmd[1] = sensor;
+	cmd[2] = (pConfig->changeSensitivityEnabled ? SIM_FLAG_CHANGE_ENABLED : 0) |
+		(pConfig->changeSensitivityRelative ? SIM_FLAG_CHANGE_RELATIVE : 0) |
+		(pConfig->wakeupEnabled ? SIM_FLAG_WAKEUP_ENABLED : 0);
+	cmd[3] = pConfig->changeSensitivity & 0xFF;
+	cmd[4] = pConfig->changeSensitivity >> 8;
+	cmd[5] = pConfig->reportInterval_us & 0xFF;
+	cmd[6] = (pConfig->reportInterval_us >> 8) & 0xFF;
+	cmd[7] = (pConfig->reportInterval_us >> 16) & 0xFF;
+	cmd[8] = pConfig->reportInterval_us >> 24;
+
+	return shdev_i2c(pSh->pDev, cmd, sizeof(cmd), 0, 0);
+}
@@ -0,0 +1,192 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef HOST_STM32F4XX_HAL_H
+#define HOST_STM32F4XX_HAL_H
+
+// Stand-in for the parts of the STM32F4 HAL used by the console and the
+// sensor app, for the Linux simulation build.  The USART is modelled by a
+// thread in host_hal.c that paces transmit by the programmed BRR and feeds
+// receive from stdin.  TIM2 counts from the host's monotonic clock at the
+// rate its prescaler gives, and raises its update and CC1 interrupts.  The
+// DWT cycle counter counts that clock's ns: a 1 GHz core.
+
+#include <stdint.h>
+
+typedef enum {
+	HAL_OK = 0,
+	HAL_ERROR,
+	HAL_BUSY,
+	HAL_TIMEOUT,
+} HAL_StatusTypeDef;
+
+typedef enum {
+	RESET = 0,
+	SET = !RESET,
+} FlagStatus;
+
+typedef enum {
+	TIM2_IRQn = 28,
+	USART2_IRQn = 38,
+} IRQn_Type;
+
+typedef struct {
+	volatile uint32_t SR;
+	volatile uint32_t DR;
+	volatile uint32_t BRR;
+	volatile uint32_t CR1;
+} USART_TypeDef;
+
+typedef struct {
+	uint32_t BaudRate;
+} UART_InitTypeDef;
+
+typedef struct {
+	USART_TypeDef *Instance;
+	UART_InitTypeDef Init;
+} UART_HandleTypeDef;
+
+typedef struct {
+	volatile uint32_t PSC;
+	volatile uint32_t CCR1;
+	volatile uint32_t DIER;
+	volatile uint32_t SR;
+	volatile uint32_t EGR;
+} TIM_TypeDef;
+
+typedef struct {
+	TIM_TypeDef *Instance;
+} TIM_HandleTypeDef;
+
+typedef struct {
+	uint32_t APB1CLKDivider;
+} RCC_ClkInitTypeDef;
+
+// Peripherals the simulation doesn't model
+typedef struct {
+	int unused;
+} I2C_HandleTypeDef;
+
+extern USART_TypeDef host_usart2;
+#define USART2 (&host_usart2)
+
+extern TIM_TypeDef host_tim2;
+#define TIM2 (&host_tim2)
+
+// Core debug and DWT, for the cycle counter.  DWT->CYCCNT reads the clock
+// each time; the registers are per thread.
+typedef struct {
+	volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+	volatile uint32_t CTRL;
+	volatile uint32_t CYCCNT;
+} DWT_Type;
+
+extern CoreDebug_Type host_coreDebug;
+#define CoreDebug (&host_coreDebug)
+#define DWT (host_dwt())
+DWT_Type *host_dwt(void);
+
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk     (1UL)
+
+// Rate of the cycle counter
+extern uint32_t SystemCoreClock;
+
+#define USART_SR_TC     ((uint32_t)0x00000040)
+#define USART_CR1_UE    ((uint32_t)0x00002000)
+#define UART_FLAG_TC    USART_SR_TC
+
+#define __HAL_UART_GET_FLAG(__HANDLE__, __FLAG__) \
+	((((__HANDLE__)->Instance->SR) & (__FLAG__)) == (__FLAG__))
+#define __HAL_UART_ENABLE(__HANDLE__)  ((__HANDLE__)->Instance->CR1 |= USART_CR1_UE)
+#define __HAL_UART_DISABLE(__HANDLE__) ((__HANDLE__)->Instance->CR1 &= ~USART_CR1_UE)
+
+#define UART_DIV_SAMPLING16(_PCLK_, _BAUD_)     (((_PCLK_)*25U)/(4U*(_BAUD_)))
+#define UART_DIVMANT_SAMPLING16(_PCLK_, _BAUD_) (UART_DIV_SAMPLING16((_PCLK_), (_BAUD_))/100U)
+#define UART_DIVFRAQ_SAMPLING16(_PCLK_, _BAUD_) (((UART_DIV_SAMPLING16((_PCLK_), (_BAUD_)) - (UART_DIVMANT_SAMPLING16((_PCLK_), (_BAUD_)) * 100U)) * 16U + 50U) / 100U)
+#define UART_BRR_SAMPLING16(_PCLK_, _BAUD_)     (((UART_DIVMANT_SAMPLING16((_PCLK_), (_BAUD_)) << 4U) + \
+                                                 (UART_DIVFRAQ_SAMPLING16((_PCLK_), (_BAUD_)) & 0xF0U)) + \
+                                                 (UART_DIVFRAQ_SAMPLING16((_PCLK_), (_BAUD_)) & 0x0FU))
+
+#define RCC_HCLK_DIV1   ((uint32_t)0x00000000)
+#define RCC_HCLK_DIV2   ((uint32_t)0x00001000)
+
+#define TIM_FLAG_UPDATE ((uint32_t)0x0001)
+#define TIM_FLAG_CC1    ((uint32_t)0x0002)
+#define TIM_IT_UPDATE   TIM_FLAG_UPDATE
+#define TIM_IT_CC1      TIM_FLAG_CC1
+#define TIM_EGR_UG      ((uint32_t)0x0001)
+#define TIM_CHANNEL_1   ((uint32_t)0x0000)
+
+// The counter isn't a plain field on the host
+#define __HAL_TIM_GET_COUNTER(__HANDLE__) host_timGetCounter(__HANDLE__)
+#define __HAL_TIM_SET_COUNTER(__HANDLE__, __COUNTER__) \
+	host_timSetCounter((__HANDLE__), (__COUNTER__))
+#define __HAL_TIM_SET_PRESCALER(__HANDLE__, __PRESC__) ((__HANDLE__)->Instance->PSC = (__PRESC__))
+#define __HAL_TIM_SET_COMPARE(__HANDLE__, __CHANNEL__, __COMPARE__) \
+	((__HANDLE__)->Instance->CCR1 = (__COMPARE__))
+#define __HAL_TIM_ENABLE_IT(__HANDLE__, __INTERRUPT__) ((__HANDLE__)->Instance->DIER |= (__INTERRUPT__))
+#define __HAL_TIM_GET_FLAG(__HANDLE__, __FLAG__) \
+	((((__HANDLE__)->Instance->SR) & (__FLAG__)) == (__FLAG__))
+#define __HAL_TIM_CLEAR_FLAG(__HANDLE__, __FLAG__) \
+	__sync_fetch_and_and(&(__HANDLE__)->Instance->SR, ~(__FLAG__))
+
+// Data memory barrier
+#define __DMB() __sync_synchronize()
+
+// HAL tick, ms since HAL_Init (the board's TIM1)
+HAL_StatusTypeDef HAL_Init(void);
+uint32_t HAL_GetTick(void);
+
+// Same clock tree as the board: APB1 at 42 MHz, HCLK/2
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+void HAL_RCC_GetClockConfig(RCC_ClkInitTypeDef *pClkInit, uint32_t *pFLatency);
+
+// Interrupt masking.  Each IRQ is a lock held by its simulated ISR, so
+// disabling an IRQ excludes the ISR exactly as on the target.
+void HAL_NVIC_DisableIRQ(IRQn_Type irq);
+void HAL_NVIC_EnableIRQ(IRQn_Type irq);
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart,
+                                        uint8_t *pData, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart,
+                                      uint8_t *pData, uint16_t size);
+
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim);
+uint32_t host_timGetCounter(TIM_HandleTypeDef *htim);
+void host_timSetCounter(TIM_HandleTypeDef *htim, uint32_t count);
+
+// Host only: TIM2's count without wrapping, for checking the timebase.
+uint64_t host_timCount64(void);
+
+// TIM2 interrupt, implemented by the application
+void TIM2_IRQHandler(void);
+
+// Completion callbacks, implemented by the console
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart);
+
+// Start the simulated UART.  Transmitted bytes are written to outFd, or
+// discarded if outFd is negative.  Received bytes are read from inFd, if
+// it isn't negative.
+void host_uartStart(UART_HandleTypeDef *huart, int outFd, int inFd);
+
+#endif
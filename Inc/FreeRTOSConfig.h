@@ -123,6 +123,7 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelayUntil             0
 #define INCLUDE_vTaskDelay                  1
 #define INCLUDE_xTaskGetSchedulerState      1
+#define INCLUDE_xTaskGetCurrentTaskHandle   1
 
 /* Cortex-M specific definitions. */
 #ifdef __NVIC_PRIO_BITS
@@ -166,6 +167,39 @@ standard names. */
 
 /* USER CODE BEGIN Defines */   	      
 /* Section where parameter definitions can be added (for instance, to override default ones in FreeRTOS.h) */
+
+/* Task run times count the TIM2 1us timebase (the console's top view).
+bno_init starts TIM2 before the scheduler, so there is nothing to
+configure.  The 32-bit counters wrap every 71 minutes. */
+#define configGENERATE_RUN_TIME_STATS            1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()         timebase_now32()
+
+/* Set to 1 for tickless idle: with every task blocked, the idle task stops
+the tick and sleeps (WFI) until the next timeout or any interrupt - INTN,
+UART, DMA or a TIM2 deadline.  TIM2 runs on through sleep.  The hooks in
+freertos.c stop the HAL tick (TIM1) and catch it up after. */
+#define configUSE_TICKLESS_IDLE                  0
+#define configPRE_SLEEP_PROCESSING               PreSleepProcessing
+#define configPOST_SLEEP_PROCESSING              PostSleepProcessing
+
+/* Task response times for the console's tasks view (app_tasks.c): from
+made ready to blocked again.  Only tasks.c expands these.  Tasks outside
+the task table have number 0 and are ignored. */
+#define traceMOVED_TASK_TO_READY_STATE( pxTCB ) \
+    appTasks_traceReady( ( pxTCB )->uxTaskNumber )
+#define traceTASK_SWITCHED_OUT() \
+    appTasks_traceSwitchedOut( pxCurrentTCB->uxTaskNumber, \
+        listLIST_ITEM_CONTAINER( &( pxCurrentTCB->xGenericListItem ) ) != \
+        ( void * ) &( pxReadyTasksLists[ pxCurrentTCB->uxPriority ] ) )
+
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+    extern uint32_t timebase_now32(void);
+    void PreSleepProcessing(uint32_t *ulExpectedIdleTime);
+    void PostSleepProcessing(uint32_t *ulExpectedIdleTime);
+    void appTasks_traceReady(unsigned long number);
+    void appTasks_traceSwitchedOut(unsigned long number, long blocked);
+#endif
 /* USER CODE END Defines */ 
 
 #endif /* FREERTOS_CONFIG_H */
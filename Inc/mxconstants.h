@@ -40,6 +40,12 @@
 
 /* USER CODE BEGIN Private defines */
 
+/* Console baud rate at startup.  (Can be changed at runtime with
+   console_setBaud.) */
+#ifndef CONSOLE_BAUD
+#define CONSOLE_BAUD 115200
+#endif
+
 /* USER CODE END Private defines */
 
 /**
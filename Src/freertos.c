@@ -36,7 +36,8 @@
 #include "task.h"
 
 /* USER CODE BEGIN Includes */     
-
+#include "stm32f4xx_hal.h"
+#include "cpu_stats.h"
 /* USER CODE END Includes */
 
 /* Variables -----------------------------------------------------------------*/
@@ -54,7 +55,35 @@
 /* Hook prototypes */
 
 /* USER CODE BEGIN Application */
-     
+#if configUSE_TICKLESS_IDLE == 1
+extern TIM_HandleTypeDef htim1;
+
+/* Sleep not yet credited to the HAL tick (us) */
+static uint32_t halTickDebt_us;
+
+/* The idle task is about to sleep, interrupts masked.  Stop the HAL tick:
+its 1 kHz interrupt would end every sleep. */
+void PreSleepProcessing(uint32_t *ulExpectedIdleTime)
+{
+  HAL_SuspendTick();
+  cpuStats_sleepBegin();
+}
+
+/* Awake, interrupts still masked.  Credit the HAL tick with the time
+slept, from TIM2, and drop the update TIM1 flagged meanwhile, if any.
+Over many sleeps the two cancel, to within a tick. */
+void PostSleepProcessing(uint32_t *ulExpectedIdleTime)
+{
+  halTickDebt_us += cpuStats_sleepEnd();
+  while (halTickDebt_us >= 1000)
+  {
+    HAL_IncTick();
+    halTickDebt_us -= 1000;
+  }
+  __HAL_TIM_CLEAR_IT(&htim1, TIM_IT_UPDATE);
+  HAL_ResumeTick();
+}
+#endif
 /* USER CODE END Application */
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
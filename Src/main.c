@@ -38,17 +38,21 @@
 #include "dbg.h"
 #include "sh_bno_stm32f401.h"
 #include "sensor_app.h"
+#include "shell.h"
+#include "rtos_pool.h"
+#include "app_tasks.h"
+#include "prof.h"
 
 /* USER CODE END Includes */
 
 /* Private variables ---------------------------------------------------------*/
 I2C_HandleTypeDef hi2c1;
+DMA_HandleTypeDef hdma_i2c1_rx;
 
 TIM_HandleTypeDef htim2;
 
 UART_HandleTypeDef huart2;
-
-osThreadId defaultTaskHandle;
+DMA_HandleTypeDef hdma_usart2_tx;
 
 /* USER CODE BEGIN PV */
 /* Private variables ---------------------------------------------------------*/
@@ -58,10 +62,10 @@ osThreadId defaultTaskHandle;
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_I2C1_Init(void);
 static void MX_USART2_UART_Init(void);
 static void MX_TIM2_Init(void);
-void StartDefaultTask(void const * argument);
 
 /* USER CODE BEGIN PFP */
 /* Private function prototypes -----------------------------------------------*/
@@ -71,15 +75,40 @@ void StartDefaultTask(void const * argument);
 /* USER CODE BEGIN 0 */
 
 #define SENSOR_TASK_STACK 512
-#define SENSOR_TASK_PRIO 0       // lowest priority
+#define OUTPUT_TASK_STACK 512
+#define SHELL_TASK_STACK 512
+#define HOUSEKEEPING_TASK_STACK 384
 
 xTaskHandle sensorTaskHandle;
-
-static void sensorThread(void * params)
-{
-  // Call into sensor_app.  (Never returns.)
-  sensorTask();
-}
+xTaskHandle outputTaskHandle;
+xTaskHandle shellTaskHandle;
+xTaskHandle housekeepingTaskHandle;
+
+// The tasks, in deadline order, which sets their priorities.  The sensor
+// task must drain a hub within a 400Hz report interval; the output task
+// must keep up before the event queue fills; the shell must echo typing;
+// housekeeping runs once a second.
+static const appTask_t appTasks[] = {
+  // Name, entry, stack (words), priority, deadline (us), woken by
+  { "SensorTask", sensorTask, SENSOR_TASK_STACK, 4, 2500,
+    APP_TASK_ISR(EXTI15_10) | APP_TASK_ISR(EXTI9_5) | APP_TASK_ISR(TIM2) |
+    APP_TASK_ISR(I2C1_EV) | APP_TASK_ISR(I2C1_ER) | APP_TASK_ISR(I2C1_DMA),
+    &sensorTaskHandle },
+  { "OutputTask", outputTask, OUTPUT_TASK_STACK, 3, 20000,
+    // Released by SensorTask's queue sends; the ring space it waits for
+    // is freed by the TX complete callback, from the USART2 TC interrupt.
+    APP_TASK_ISR(USART2), &outputTaskHandle },
+  { "ShellTask", shellTask, SHELL_TASK_STACK, 2, 100000,
+    APP_TASK_ISR(USART2), &shellTaskHandle },
+  { "Housekeeping", housekeepingTask, HOUSEKEEPING_TASK_STACK, 1, 1000000,
+    APP_TASK_ISR(SYSTICK), &housekeepingTaskHandle },
+};
+
+RTOS_POOL(taskPool, "tasks",
+          RTOS_TASK_BYTES(SENSOR_TASK_STACK) +
+          RTOS_TASK_BYTES(OUTPUT_TASK_STACK) +
+          RTOS_TASK_BYTES(SHELL_TASK_STACK) +
+          RTOS_TASK_BYTES(HOUSEKEEPING_TASK_STACK));
 
 /* USER CODE END 0 */
 
@@ -100,13 +129,23 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_I2C1_Init();
   MX_USART2_UART_Init();
   MX_TIM2_Init();
 
   /* USER CODE BEGIN 2 */
+  // The console's startup rate, over CubeMX's 115200.  (Nothing has been
+  // sent yet.)
+  huart2.Init.BaudRate = CONSOLE_BAUD;
+  HAL_UART_Init(&huart2);
   dbgInit();
+  prof_init();
   bno_init(&hi2c1, &htim2);
+#if configUSE_TICKLESS_IDLE == 1
+  // Keep the debugger attached while the core sleeps
+  HAL_DBGMCU_EnableDBGSleepMode();
+#endif
 
   /* USER CODE END 2 */
 
@@ -122,17 +161,11 @@ int main(void)
   /* start timers, add new ones, ... */
   /* USER CODE END RTOS_TIMERS */
 
-  /* Create the thread(s) */
-  /* definition and creation of defaultTask */
-  osThreadDef(defaultTask, StartDefaultTask, osPriorityNormal, 0, 128);
-  defaultTaskHandle = osThreadCreate(osThread(defaultTask), NULL);
-
   /* USER CODE BEGIN RTOS_THREADS */
-  xTaskCreate(sensorThread, "SensorTask", 
-              SENSOR_TASK_STACK, 
-              0, 
-              SENSOR_TASK_PRIO, &sensorTaskHandle);
-  
+  sensorApp_init();
+  rtosPool_begin(&taskPool);
+  appTasks_create(appTasks, sizeof(appTasks) / sizeof(appTasks[0]));
+  rtosPool_end();
   /* USER CODE END RTOS_THREADS */
 
   /* USER CODE BEGIN RTOS_QUEUES */
@@ -221,7 +254,7 @@ void MX_TIM2_Init(void)
   TIM_MasterConfigTypeDef sMasterConfig;
 
   htim2.Instance = TIM2;
-  htim2.Init.Prescaler = 84;
+  htim2.Init.Prescaler = 83;
   htim2.Init.CounterMode = TIM_COUNTERMODE_UP;
   htim2.Init.Period = 0xFFFFFFFF;
   htim2.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
@@ -252,6 +285,22 @@ void MX_USART2_UART_Init(void)
 
 }
 
+/** 
+  * Enable DMA controller clock
+  */
+void MX_DMA_Init(void) 
+{
+  /* DMA controller clock enable */
+  __DMA1_CLK_ENABLE();
+
+  /* DMA interrupt init */
+  HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
+  HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+
+}
+
 /** Configure pins as 
         * Analog 
         * Input 
@@ -296,19 +345,6 @@ void MX_GPIO_Init(void)
 
 /* USER CODE END 4 */
 
-/* StartDefaultTask function */
-void StartDefaultTask(void const * argument)
-{
-
-  /* USER CODE BEGIN 5 */
-  /* Infinite loop */
-  for(;;)
-  {
-    osDelay(1);
-  }
-  /* USER CODE END 5 */ 
-}
-
 #ifdef USE_FULL_ASSERT
 
 /**
@@ -37,11 +37,15 @@
 #include "cmsis_os.h"
 
 /* USER CODE BEGIN 0 */
-
+#include "timebase.h"
+#include "sh_bno_stm32f401.h"
+#include "cpu_stats.h"
 /* USER CODE END 0 */
 
 /* External variables --------------------------------------------------------*/
+extern DMA_HandleTypeDef hdma_i2c1_rx;
 extern I2C_HandleTypeDef hi2c1;
+extern DMA_HandleTypeDef hdma_usart2_tx;
 extern UART_HandleTypeDef huart2;
 
 extern TIM_HandleTypeDef htim1;
@@ -56,11 +60,11 @@ extern TIM_HandleTypeDef htim1;
 void SysTick_Handler(void)
 {
   /* USER CODE BEGIN SysTick_IRQn 0 */
-
+  uint32_t start = cpuStats_isrEnter();
   /* USER CODE END SysTick_IRQn 0 */
   osSystickHandler();
   /* USER CODE BEGIN SysTick_IRQn 1 */
-
+  cpuStats_isrExit(CPU_ISR_SYSTICK, start);
   /* USER CODE END SysTick_IRQn 1 */
 }
 
@@ -77,25 +81,80 @@ void SysTick_Handler(void)
 void TIM1_UP_TIM10_IRQHandler(void)
 {
   /* USER CODE BEGIN TIM1_UP_TIM10_IRQn 0 */
-
+  uint32_t start = cpuStats_isrEnter();
   /* USER CODE END TIM1_UP_TIM10_IRQn 0 */
   HAL_TIM_IRQHandler(&htim1);
   /* USER CODE BEGIN TIM1_UP_TIM10_IRQn 1 */
-
+  cpuStats_isrExit(CPU_ISR_TIM1, start);
   /* USER CODE END TIM1_UP_TIM10_IRQn 1 */
 }
 
+/**
+* @brief This function handles DMA1 stream0 global interrupt.
+*/
+void DMA1_Stream0_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream0_IRQn 0 */
+  uint32_t start = cpuStats_isrEnter();
+  /* USER CODE END DMA1_Stream0_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_i2c1_rx);
+  /* USER CODE BEGIN DMA1_Stream0_IRQn 1 */
+  bno_i2cIsrDone(start);
+  cpuStats_isrExit(CPU_ISR_I2C1_DMA, start);
+  /* USER CODE END DMA1_Stream0_IRQn 1 */
+}
+
+/**
+* @brief This function handles DMA1 stream6 global interrupt.
+*/
+void DMA1_Stream6_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream6_IRQn 0 */
+  uint32_t start = cpuStats_isrEnter();
+  /* USER CODE END DMA1_Stream6_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_usart2_tx);
+  /* USER CODE BEGIN DMA1_Stream6_IRQn 1 */
+  cpuStats_isrExit(CPU_ISR_USART2_DMA, start);
+  /* USER CODE END DMA1_Stream6_IRQn 1 */
+}
+
+/**
+* @brief This function handles TIM2 global interrupt.
+*/
+void TIM2_IRQHandler(void)
+{
+  /* USER CODE BEGIN TIM2_IRQn 0 */
+  // TIM2 is the event timebase (update, CC1), INTN capture (CC3) and
+  // wait deadlines (CC4).  Each handler checks and clears its own flags.
+  // The return deliberately skips the HAL_TIM_IRQHandler(&htim2) call
+  // CubeMX generates after this block.  That would dispatch TIM2's update
+  // to HAL_TIM_PeriodElapsedCallback, which is the HAL tick for TIM1 and
+  // doesn't check the instance, and the capture and compare events to
+  // callbacks nothing here implements.
+  uint32_t start = cpuStats_isrEnter();
+  timebase_irqHandler();
+  bno_captureIrqHandler();
+  bno_deadlineIrqHandler();
+  cpuStats_isrExit(CPU_ISR_TIM2, start);
+  return;
+  /* USER CODE END TIM2_IRQn 0 */
+  /* USER CODE BEGIN TIM2_IRQn 1 */
+
+  /* USER CODE END TIM2_IRQn 1 */
+}
+
 /**
 * @brief This function handles I2C1 event interrupt.
 */
 void I2C1_EV_IRQHandler(void)
 {
   /* USER CODE BEGIN I2C1_EV_IRQn 0 */
-
+  uint32_t start = cpuStats_isrEnter();
   /* USER CODE END I2C1_EV_IRQn 0 */
   HAL_I2C_EV_IRQHandler(&hi2c1);
   /* USER CODE BEGIN I2C1_EV_IRQn 1 */
-
+  bno_i2cIsrDone(start);
+  cpuStats_isrExit(CPU_ISR_I2C1_EV, start);
   /* USER CODE END I2C1_EV_IRQn 1 */
 }
 
@@ -105,11 +164,12 @@ void I2C1_EV_IRQHandler(void)
 void I2C1_ER_IRQHandler(void)
 {
   /* USER CODE BEGIN I2C1_ER_IRQn 0 */
-
+  uint32_t start = cpuStats_isrEnter();
   /* USER CODE END I2C1_ER_IRQn 0 */
   HAL_I2C_ER_IRQHandler(&hi2c1);
   /* USER CODE BEGIN I2C1_ER_IRQn 1 */
-
+  bno_i2cIsrDone(start);
+  cpuStats_isrExit(CPU_ISR_I2C1_ER, start);
   /* USER CODE END I2C1_ER_IRQn 1 */
 }
 
@@ -119,11 +179,11 @@ void I2C1_ER_IRQHandler(void)
 void USART2_IRQHandler(void)
 {
   /* USER CODE BEGIN USART2_IRQn 0 */
-
+  uint32_t start = cpuStats_isrEnter();
   /* USER CODE END USART2_IRQn 0 */
   HAL_UART_IRQHandler(&huart2);
   /* USER CODE BEGIN USART2_IRQn 1 */
-
+  cpuStats_isrExit(CPU_ISR_USART2, start);
   /* USER CODE END USART2_IRQn 1 */
 }
 
@@ -133,15 +193,26 @@ void USART2_IRQHandler(void)
 void EXTI15_10_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI15_10_IRQn 0 */
-
+  uint32_t start = cpuStats_isrEnter();
   /* USER CODE END EXTI15_10_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_10);
   /* USER CODE BEGIN EXTI15_10_IRQn 1 */
-
+  cpuStats_isrExit(CPU_ISR_EXTI15_10, start);
   /* USER CODE END EXTI15_10_IRQn 1 */
 }
 
 /* USER CODE BEGIN 1 */
 
+/**
+* @brief This function handles EXTI line[9:5] interrupts: INTN of a
+* second hub (BNO_NUM_UNITS > 1).
+*/
+void EXTI9_5_IRQHandler(void)
+{
+  uint32_t start = cpuStats_isrEnter();
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_8);
+  cpuStats_isrExit(CPU_ISR_EXTI9_5, start);
+}
+
 /* USER CODE END 1 */
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
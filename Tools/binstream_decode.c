@@ -0,0 +1,173 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and 
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+// Host side decoder for the sensor app's BINARY_OUTPUT stream.
+//
+// Reads COBS framed records from a file or serial device (stdin by default)
+// and writes the equivalent DSF text to stdout.  Corrupt frames are counted
+// and reported on stderr at exit.
+//
+// Build on Linux:
+//   cc -std=c99 -O2 -I../Hillcrest -o binstream_decode binstream_decode.c ../Hillcrest/binstream.c
+//
+// Usage (configure the port first, e.g. stty -F /dev/ttyACM0 115200 raw):
+//   ./binstream_decode /dev/ttyACM0 > log.dsf
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "binstream.h"
+
+#define MAX_FRAME (1024)
+
+// last extended sequence number per DSF channel
+static uint32_t lastSequence[4 * BINSTREAM_UNIT_CHANNELS];
+
+// last extended timestamp.  Records carry 32 bits of a 64-bit us timebase;
+// events arrive within a few ms of each other, so the nearest 64-bit time
+// to the previous one is the right one.
+static uint64_t lastTime_us;
+static bool haveTime = false;
+
+static unsigned framesOk = 0;
+static unsigned framesBad = 0;
+
+static double fromQ(int16_t v, unsigned q)
+{
+	return (double)v / (double)(1 << q);
+}
+
+static void printEvent(const binstream_event_t *pEvent)
+{
+	unsigned channel = pEvent->unit * BINSTREAM_UNIT_CHANNELS + pEvent->sensor;
+
+	// Compute sample_id the same way printDsf() does
+	uint8_t deltaSeq = pEvent->sequence - (lastSequence[channel] & 0xFF);
+	lastSequence[channel] += deltaSeq;
+
+	if (!haveTime) {
+		haveTime = true;
+		lastTime_us = pEvent->time_us;
+	}
+	else {
+		int32_t deltaTime = (int32_t)(pEvent->time_us - (uint32_t)lastTime_us);
+		lastTime_us += deltaTime;
+	}
+
+	printf(".%u %0.6f, %u",
+	       channel,
+	       lastTime_us / 1000000.0,
+	       lastSequence[channel]);
+
+	switch (pEvent->format) {
+	case BINSTREAM_FMT_RAW3:
+		printf(", %d, %d, %d\n", pEvent->v[0], pEvent->v[1], pEvent->v[2]);
+		break;
+	case BINSTREAM_FMT_Q3:
+		printf(", %0.3f, %0.3f, %0.3f\n",
+		       fromQ(pEvent->v[0], pEvent->qPoint),
+		       fromQ(pEvent->v[1], pEvent->qPoint),
+		       fromQ(pEvent->v[2], pEvent->qPoint));
+		break;
+	case BINSTREAM_FMT_Q3_STATUS:
+		printf(", %0.3f, %0.3f, %0.3f, %u\n",
+		       fromQ(pEvent->v[0], pEvent->qPoint),
+		       fromQ(pEvent->v[1], pEvent->qPoint),
+		       fromQ(pEvent->v[2], pEvent->qPoint),
+		       pEvent->status & 0x3);
+		break;
+	case BINSTREAM_FMT_QUAT:
+		printf(", %0.3f, %0.3f, %0.3f, %0.3f, %0.3f\n",
+		       fromQ(pEvent->v[0], pEvent->qPoint),
+		       fromQ(pEvent->v[1], pEvent->qPoint),
+		       fromQ(pEvent->v[2], pEvent->qPoint),
+		       fromQ(pEvent->v[3], pEvent->qPoint),
+		       fromQ(pEvent->v[4], pEvent->qPointLast));
+		break;
+	default:
+		printf("\n");
+		fprintf(stderr, "Unknown format %d, sensor %d\n",
+		        pEvent->format, pEvent->sensor);
+		break;
+	}
+}
+
+static void handleFrame(uint8_t *pFrame, size_t len)
+{
+	binstream_event_t event;
+
+	len = binstream_unframe(pFrame, len);
+	if (len == 0) {
+		framesBad++;
+		return;
+	}
+
+	if (pFrame[0] == BINSTREAM_TYPE_HEADER) {
+		printf("%.*s\n", (int)(len - 1), (const char *)&pFrame[1]);
+		framesOk++;
+	}
+	else if (binstream_decodeEvent(&event, pFrame, len) == 0) {
+		printEvent(&event);
+		framesOk++;
+	}
+	else {
+		framesBad++;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	static uint8_t frame[MAX_FRAME];
+	size_t len = 0;
+	bool overflow = false;
+	FILE *in = stdin;
+	int c;
+
+	if (argc > 1) {
+		in = fopen(argv[1], "rb");
+		if (in == 0) {
+			perror(argv[1]);
+			return 1;
+		}
+	}
+
+	while ((c = fgetc(in)) != EOF) {
+		if (c == 0) {
+			// End of frame
+			if (overflow) {
+				framesBad++;
+			}
+			else if (len > 0) {
+				handleFrame(frame, len);
+			}
+			len = 0;
+			overflow = false;
+		}
+		else if (len < sizeof(frame)) {
+			frame[len++] = c;
+		}
+		else {
+			overflow = true;
+		}
+	}
+
+	fprintf(stderr, "%u frames decoded, %u corrupt.\n", framesOk, framesBad);
+
+	return 0;
+}
@@ -0,0 +1,123 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+// Check of Hillcrest/fixfmt.c against printf.
+//
+// Sweeps every int16 value through each Q format the event printers use
+// (Q4, Q8, Q12, Q14 with three decimals), the accuracy in degrees that
+// printEvent() computes with the float 180/pi, and a range of timestamps.
+// Each is compared with snprintf of the float the printers used to pass
+// to printf.  Prints the first mismatches and exits 1 if there are any.
+//
+// Build on Linux:
+//   cc -std=c99 -O2 -IHillcrest -o fixfmt_check Tools/fixfmt_check.c Hillcrest/fixfmt.c
+//
+// Usage:
+//   ./fixfmt_check
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fixfmt.h"
+
+// Mismatches printed before going quiet
+#define MAX_REPORTS (10)
+
+static unsigned checks = 0;
+static unsigned mismatches = 0;
+
+static void compare(const char *what, long long v, const char *got, const char *want)
+{
+	checks++;
+	if (strcmp(got, want) != 0) {
+		if (mismatches++ < MAX_REPORTS) {
+			printf("%s %lld: fixfmt \"%s\", printf \"%s\"\n", what, v, got, want);
+		}
+	}
+}
+
+// v / 2^q as the printers' FROM_16Qn macros computed it
+static float fromQ(int16_t v, unsigned q)
+{
+	return v * (1.0f / (1 << q));
+}
+
+static void checkQ(unsigned q)
+{
+	char got[32], want[32];
+	char what[8];
+
+	snprintf(what, sizeof(what), "Q%u", q);
+	for (int32_t v = INT16_MIN; v <= INT16_MAX; v++) {
+		fixfmt_q(got, v, q, 3);
+		snprintf(want, sizeof(want), "%0.3f", fromQ(v, q));
+		compare(what, v, got, want);
+	}
+}
+
+static void checkDegrees(void)
+{
+	const float scaleRadToDeg = 180.0 / 3.14159265358;
+	char got[32], want[32];
+
+	// The constant fixfmt.h gives for it
+	if (scaleRadToDeg != (float)FIXFMT_RAD_TO_DEG_MANT / (1 << FIXFMT_RAD_TO_DEG_Q)) {
+		printf("FIXFMT_RAD_TO_DEG_MANT does not match 180/pi as a float\n");
+		mismatches++;
+	}
+
+	for (int32_t v = INT16_MIN; v <= INT16_MAX; v++) {
+		fixfmt_qFloat(got, (int64_t)v * FIXFMT_RAD_TO_DEG_MANT,
+		              12 + FIXFMT_RAD_TO_DEG_Q, 3);
+		snprintf(want, sizeof(want), "%0.3f", scaleRadToDeg * fromQ(v, 12));
+		compare("deg Q12", v, got, want);
+	}
+}
+
+static void checkTime(void)
+{
+	char got[32], want[32];
+
+	// Every us of the first ten seconds, then a stride across 32 bits
+	// of seconds.
+	for (uint64_t t = 0; t < 10000000; t++) {
+		fixfmt_time_us(got, t);
+		snprintf(want, sizeof(want), "%0.6f", t / 1000000.0);
+		compare("time_us", (long long)t, got, want);
+	}
+	for (uint64_t t = 10000000; t < 4294967296ULL * 1000000; t += 999999937) {
+		fixfmt_time_us(got, t);
+		snprintf(want, sizeof(want), "%0.6f", t / 1000000.0);
+		compare("time_us", (long long)t, got, want);
+	}
+}
+
+int main(void)
+{
+	checkQ(4);
+	checkQ(8);
+	checkQ(12);
+	checkQ(14);
+	checkDegrees();
+	checkTime();
+
+	printf("%u checks, %u mismatches.\n", checks, mismatches);
+
+	return (mismatches == 0) ? 0 : 1;
+}
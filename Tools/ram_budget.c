@@ -0,0 +1,282 @@
+/****************************************************************************
+* Copyright (C) 2016 Hillcrest Laboratories, Inc.
+*
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License and
+* any applicable agreements you may have with Hillcrest Laboratories, Inc.
+* You may obtain a copy of the License at
+*
+*   http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+// RAM per module, from the IAR linker map's module summary.
+//
+// Lists the rw data of each object file in the project, each library, and
+// the linker's own blocks (stack and heap), largest first, against the
+// STM32F401's 96 KB.  Given a budget file of "module bytes" lines (# starts
+// a comment), it marks the modules over budget and exits 1 if any are, or
+// if the budget names a module the map lacks.
+// With STATIC_RTOS_ALLOC the kernel objects are in their modules' lines.
+//
+// Build on Linux:
+//   cc -std=c99 -O2 -o ram_budget ram_budget.c
+//
+// Usage (enable Linker > List > Generate linker map file):
+//   ./ram_budget EWARM/sh1-demo/List/sh1-demo.map [budget.txt]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+
+#define RAM_BYTES (96 * 1024)
+#define MAX_MODULES (256)
+#define MAX_NAME (64)
+#define MAX_LINE (512)
+
+typedef struct module_s {
+	char name[MAX_NAME];
+	unsigned ram;
+	long budget;   // -1: none given
+} module_t;
+
+static module_t modules[MAX_MODULES];
+static unsigned numModules = 0;
+
+// Columns of the rw data figures: right aligned, ending at rwEnd, after
+// the ro data column that ends at rwStart.
+static size_t rwStart = 0;
+static size_t rwEnd = 0;
+
+// Parse the figure in [rwStart, rwEnd).  Digits may be grouped with spaces
+// or apostrophes, and a blank field is 0.
+static unsigned rwData(const char *line)
+{
+	unsigned value = 0;
+	size_t len = strlen(line);
+
+	for (size_t n = rwStart; (n < rwEnd) && (n < len); n++) {
+		if (isdigit((unsigned char)line[n])) {
+			value = value * 10 + (line[n] - '0');
+		}
+	}
+
+	return value;
+}
+
+static module_t *addModule(const char *name)
+{
+	if (numModules >= MAX_MODULES) {
+		fprintf(stderr, "Too many modules, raise MAX_MODULES.\n");
+		exit(2);
+	}
+
+	module_t *pModule = &modules[numModules++];
+	snprintf(pModule->name, sizeof(pModule->name), "%s", name);
+	pModule->ram = 0;
+	pModule->budget = -1;
+
+	return pModule;
+}
+
+static module_t *findModule(const char *name)
+{
+	for (unsigned n = 0; n < numModules; n++) {
+		if (strcmp(modules[n].name, name) == 0) {
+			return &modules[n];
+		}
+	}
+
+	return 0;
+}
+
+// Last path component of a group header, "C:\...\Obj: [1]" or "dl7M_tln.a: [2]"
+static void groupName(const char *line, char *name, size_t len)
+{
+	const char *end = strstr(line, ": [");
+	const char *start = end;
+
+	while ((start > line) && (start[-1] != '\\') && (start[-1] != '/')) {
+		start--;
+	}
+	snprintf(name, len, "%.*s", (int)(end - start), start);
+}
+
+// Read the module summary.  Returns the grand total, or -1 if the map has
+// no module summary.
+static long readMap(FILE *f)
+{
+	char line[MAX_LINE];
+	char group[MAX_NAME] = "";
+	char pending[MAX_NAME] = "";
+	bool inSummary = false;
+	bool library = false;
+
+	while (fgets(line, sizeof(line), f) != 0) {
+		line[strcspn(line, "\r\n")] = 0;
+
+		if (!inSummary) {
+			inSummary = (strstr(line, "MODULE SUMMARY") != 0);
+			continue;
+		}
+
+		char *ro = strstr(line, "ro data");
+		char *rw = strstr(line, "rw data");
+		if ((rwEnd == 0) && (ro != 0) && (rw != 0)) {
+			rwStart = (ro - line) + strlen("ro data");
+			rwEnd = (rw - line) + strlen("rw data");
+			continue;
+		}
+		if (rwEnd == 0) {
+			continue;
+		}
+
+		if (strstr(line, "Grand Total:") != 0) {
+			return rwData(line);
+		}
+		if (!isspace((unsigned char)line[0]) && (strstr(line, ": [") != 0)) {
+			groupName(line, group, sizeof(group));
+			library = (strlen(group) > 2) && (strcmp(group + strlen(group) - 2, ".a") == 0);
+			continue;
+		}
+
+		// Module lines start in column 4.  A long name gets a line of its
+		// own, its figures on the next.
+		char name[MAX_NAME];
+		if ((strncmp(line, "    ", 4) != 0) || (line[4] == '-')) {
+			continue;
+		}
+		if (line[4] == ' ') {
+			if ((pending[0] != 0) && !library) {
+				addModule(pending)->ram = rwData(line);
+			}
+			pending[0] = 0;
+			continue;
+		}
+		if (sscanf(line + 4, "%63s", name) != 1) {
+			continue;
+		}
+		if (strcmp(name, "Total:") == 0) {
+			if (library) {
+				addModule(group)->ram = rwData(line);
+			}
+		}
+		else if (strcmp(name, "Linker") == 0) {
+			addModule("(linker: stack, heap)")->ram = rwData(line);
+		}
+		else if ((strcmp(name, "Gaps") != 0) && !library) {
+			const char *rest = strstr(line, name) + strlen(name);
+			if (rest[strspn(rest, " ")] == 0) {
+				snprintf(pending, sizeof(pending), "%s", name);
+			}
+			else {
+				addModule(name)->ram = rwData(line);
+			}
+		}
+	}
+
+	return (rwEnd == 0) ? -1 : 0;
+}
+
+static int readBudgets(FILE *f)
+{
+	char line[MAX_LINE];
+	char name[MAX_NAME];
+	long bytes;
+	int errors = 0;
+
+	while (fgets(line, sizeof(line), f) != 0) {
+		line[strcspn(line, "#\r\n")] = 0;
+		if (sscanf(line, "%63s %ld", name, &bytes) != 2) {
+			continue;
+		}
+
+		module_t *pModule = findModule(name);
+		if (pModule == 0) {
+			fprintf(stderr, "Budget for %s, not in the map.\n", name);
+			errors++;
+			continue;
+		}
+		pModule->budget = bytes;
+	}
+
+	return errors;
+}
+
+static int byRam(const void *a, const void *b)
+{
+	const module_t *pA = a;
+	const module_t *pB = b;
+
+	return (pA->ram < pB->ram) - (pA->ram > pB->ram);
+}
+
+int main(int argc, char *argv[])
+{
+	FILE *f;
+	long total;
+	unsigned over = 0;
+	int unknown = 0;
+
+	if ((argc < 2) || (argc > 3)) {
+		fprintf(stderr, "Usage: %s <map file> [budget file]\n", argv[0]);
+		return 2;
+	}
+
+	f = fopen(argv[1], "r");
+	if (f == 0) {
+		perror(argv[1]);
+		return 2;
+	}
+	total = readMap(f);
+	fclose(f);
+	if (total < 0) {
+		fprintf(stderr, "%s: no module summary.\n", argv[1]);
+		return 2;
+	}
+
+	if (argc > 2) {
+		f = fopen(argv[2], "r");
+		if (f == 0) {
+			perror(argv[2]);
+			return 2;
+		}
+		unknown = readBudgets(f);
+		fclose(f);
+	}
+
+	qsort(modules, numModules, sizeof(modules[0]), byRam);
+
+	printf("%-32s %8s %8s\n", "Module", "RAM", "Budget");
+	for (unsigned n = 0; n < numModules; n++) {
+		const module_t *pModule = &modules[n];
+
+		if ((pModule->ram == 0) && (pModule->budget < 0)) {
+			continue;
+		}
+		printf("%-32s %8u", pModule->name, pModule->ram);
+		if (pModule->budget >= 0) {
+			printf(" %8ld", pModule->budget);
+			if ((long)pModule->ram > pModule->budget) {
+				printf("  over by %ld", (long)pModule->ram - pModule->budget);
+				over++;
+			}
+		}
+		printf("\n");
+	}
+	printf("%-32s %8ld of %u (%ld%%)\n", "Total", total, RAM_BYTES,
+	       (total * 100 + RAM_BYTES / 2) / RAM_BYTES);
+	if (over != 0) {
+		printf("%u modules over budget.\n", over);
+	}
+
+	return ((over != 0) || (unknown != 0)) ? 1 : 0;
+}